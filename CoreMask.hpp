@@ -0,0 +1,264 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  fixed capacity bitmask of core (or pu/numa) indices
+//
+//  stores up to CAPACITY indices in a flat array of
+//  64-bit words; copying, union, intersection and
+//  popcount never touch the heap. iteration visits set
+//  bits in ascending order, the same order as the
+//  std::set<int> it replaces.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCOREMASK__
+#define __MESOSCOREMASK__ 1
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+class CoreMask {
+
+public:
+
+  static const int CAPACITY = 4096;
+
+  static const int WORDS = CAPACITY / 64;
+
+  class const_iterator :
+    public std::iterator<std::forward_iterator_tag, int> {
+
+  public:
+
+    const_iterator(const CoreMask* mask_, const int i_)
+      : mask(mask_), i(i_) {
+    }
+
+    int operator*() const {
+      return i;
+    }
+
+    const_iterator& operator++() {
+      i = mask->next(i);
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator cur = *this;
+      i = mask->next(i);
+      return cur;
+    }
+
+    bool operator==(const const_iterator& o) const {
+      return i == o.i;
+    }
+
+    bool operator!=(const const_iterator& o) const {
+      return i != o.i;
+    }
+
+  private:
+    const CoreMask* mask;
+    int i;
+  };
+
+  CoreMask() {
+    clear();
+  }
+
+  void clear() {
+    std::memset(bits, 0, sizeof(bits));
+  }
+
+  // std::set<int> style interface, an index
+  // outside [0, CAPACITY) is rejected (false)
+  // and leaves the mask as it was
+
+  bool insert(const int i) {
+    if(i < 0 || i >= CAPACITY) {
+      return false;
+    }
+
+    bits[i >> 6] |= (UINT64_C(1) << (i & 63));
+    return true;
+  }
+
+  void erase(const int i) {
+    if(i >= 0 && i < CAPACITY) {
+      bits[i >> 6] &= ~(UINT64_C(1) << (i & 63));
+    }
+  }
+
+  // set lo..hi inclusive, a word at a time
+  bool insert(const int lo, const int hi) {
+    if(lo < 0 || hi >= CAPACITY || hi < lo) {
+      return false;
+    }
+
+    const int lw = lo >> 6;
+    const int hw = hi >> 6;
+    const uint64_t lmask = ~UINT64_C(0) << (lo & 63);
+    const uint64_t hmask = ~UINT64_C(0) >> (63 - (hi & 63));
+
+    if(lw == hw) {
+      bits[lw] |= lmask & hmask;
+      return true;
+    }
+
+    bits[lw] |= lmask;
+    for(int w = lw + 1; w < hw; w++) {
+      bits[w] = ~UINT64_C(0);
+    }
+    bits[hw] |= hmask;
+    return true;
+  }
+
+  int count(const int i) const {
+    return (i >= 0 && i < CAPACITY) ?
+      static_cast<int>((bits[i >> 6] >> (i & 63)) & 1) : 0;
+  }
+
+  // popcount
+  int size() const {
+    int n = 0;
+    for(int w = 0; w < WORDS; w++) {
+      n += __builtin_popcountll(bits[w]);
+    }
+
+    return n;
+  }
+
+  bool empty() const {
+    for(int w = 0; w < WORDS; w++) {
+      if(bits[w]) { return false; }
+    }
+
+    return true;
+  }
+
+  // lowest set index, -1 if empty
+  int first() const {
+    return next(-1);
+  }
+
+  // lowest unset index > i, CAPACITY if none
+  int nextClear(const int i) const {
+    int j = i + 1;
+    if(j >= CAPACITY) { return CAPACITY; }
+
+    int w = j >> 6;
+    uint64_t word = ~bits[w] & (~UINT64_C(0) << (j & 63));
+
+    while(!word) {
+      if(++w == WORDS) { return CAPACITY; }
+      word = ~bits[w];
+    }
+
+    return (w << 6) + __builtin_ctzll(word);
+  }
+
+  // lowest set index > i, -1 if none
+  int next(const int i) const {
+    int j = i + 1;
+    if(j >= CAPACITY) { return -1; }
+
+    int w = j >> 6;
+    uint64_t word = bits[w] & (~UINT64_C(0) << (j & 63));
+
+    while(!word) {
+      if(++w == WORDS) { return -1; }
+      word = bits[w];
+    }
+
+    return (w << 6) + __builtin_ctzll(word);
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, first());
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, -1);
+  }
+
+  CoreMask& operator|=(const CoreMask& o) {
+    for(int w = 0; w < WORDS; w++) {
+      bits[w] |= o.bits[w];
+    }
+
+    return *this;
+  }
+
+  CoreMask& operator&=(const CoreMask& o) {
+    for(int w = 0; w < WORDS; w++) {
+      bits[w] &= o.bits[w];
+    }
+
+    return *this;
+  }
+
+  // set difference
+  CoreMask& operator-=(const CoreMask& o) {
+    for(int w = 0; w < WORDS; w++) {
+      bits[w] &= ~o.bits[w];
+    }
+
+    return *this;
+  }
+
+  CoreMask operator|(const CoreMask& o) const {
+    CoreMask m = *this;
+    m |= o;
+    return m;
+  }
+
+  CoreMask operator&(const CoreMask& o) const {
+    CoreMask m = *this;
+    m &= o;
+    return m;
+  }
+
+  CoreMask operator-(const CoreMask& o) const {
+    CoreMask m = *this;
+    m -= o;
+    return m;
+  }
+
+  bool intersects(const CoreMask& o) const {
+    for(int w = 0; w < WORDS; w++) {
+      if(bits[w] & o.bits[w]) { return true; }
+    }
+
+    return false;
+  }
+
+  bool operator==(const CoreMask& o) const {
+    return std::memcmp(bits, o.bits, sizeof(bits)) == 0;
+  }
+
+  bool operator!=(const CoreMask& o) const {
+    return !(*this == o);
+  }
+
+private:
+
+  uint64_t bits[WORDS];
+
+};
+
+#endif
@@ -0,0 +1,155 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <algorithm>
+#include <limits>
+
+#include <stout/foreach.hpp>
+
+#include "CoreOccupancy.hpp"
+#include "cgroupcpusets.hpp"
+
+CoreOccupancy::CoreOccupancy()
+  : cpuHolders(CoreMask::CAPACITY, 0),
+    currentVersion(0),
+    cpuVersions(CoreMask::CAPACITY, 0) {
+}
+
+void CoreOccupancy::assign(
+  const std::string& container,
+  const CoreMask& cpus) {
+  release(container);
+
+  currentVersion++;
+
+  foreach(const int cpu, cpus) {
+    cpuHolders[cpu]++;
+    cpuVersions[cpu] = currentVersion;
+  }
+
+  containerCpus[container] = cpus;
+}
+
+bool CoreOccupancy::claim(
+  const std::string& container,
+  const CoreMask& cpus,
+  const uint64_t seen) {
+  foreach(const int cpu, cpus) {
+    if(cpuVersions[cpu] > seen) {
+      return false;
+    }
+  }
+
+  assign(container, cpus);
+  return true;
+}
+
+uint64_t CoreOccupancy::version() const {
+  return currentVersion;
+}
+
+void CoreOccupancy::release(const std::string& container) {
+  std::map<std::string, CoreMask>::iterator held = containerCpus.find(container);
+  if(held == containerCpus.end()) {
+    return;
+  }
+
+  foreach(const int cpu, held->second) {
+    cpuHolders[cpu]--;
+  }
+
+  containerCpus.erase(held);
+}
+
+Option<CoreMask> CoreOccupancy::cpus(const std::string& container) const {
+  std::map<std::string, CoreMask>::const_iterator held = containerCpus.find(container);
+  if(held == containerCpus.end()) {
+    return None();
+  }
+
+  return held->second;
+}
+
+std::vector<std::string> CoreOccupancy::containers() const {
+  std::vector<std::string> names;
+
+  for(std::map<std::string, CoreMask>::const_iterator held = containerCpus.begin();
+      held != containerCpus.end(); ++held) {
+    names.push_back(held->first);
+  }
+
+  return names;
+}
+
+int CoreOccupancy::holders(const int cpu) const {
+  return (cpu >= 0 && cpu < CoreMask::CAPACITY) ? cpuHolders[cpu] : 0;
+}
+
+// a core is as loaded as its busiest online pu,
+// both hyperthreads of one container count once
+//
+CoreLoad CoreOccupancy::load(
+  const TopologySnapshot& snapshot,
+  const std::string& except) const {
+  const int ncores = snapshot.nCores();
+
+  CoreMask excepted;
+  std::map<std::string, CoreMask>::const_iterator held = containerCpus.find(except);
+  if(held != containerCpus.end()) {
+    excepted = held->second;
+  }
+
+  CoreLoad load;
+  load.cost.resize(ncores, std::numeric_limits<float>::infinity());
+  load.weights.resize(ncores, 0.0);
+
+  for(int core = 0; core < ncores; core++) {
+    for(const int* cpu = snapshot.corePusBegin(core); cpu != snapshot.corePusEnd(core); ++cpu) {
+      if(!snapshot.onlineCpus.count(*cpu)) {
+        continue;
+      }
+
+      const float tasks = 1.0 + cpuHolders[*cpu] - (excepted.count(*cpu) ? 1 : 0);
+      load.cost[core] = (load.cost[core] == std::numeric_limits<float>::infinity()) ?
+        tasks : std::max(load.cost[core], tasks);
+    }
+
+    if(load.cost[core] != std::numeric_limits<float>::infinity()) {
+      load.weights[core] = static_cast<float>(snapshot.pusPerCore[core]) / load.cost[core];
+    }
+  }
+
+  return load;
+}
+
+CoreLoad scan_core_load(const TopologySnapshot& snapshot) {
+  CoreOccupancy occupancy;
+
+  Try<std::vector<std::string> > groups = get_cpuset_groups();
+  if(groups.isSome()) {
+    foreach(const std::string& group, groups.get()) {
+      Try<CoreMask> cpus = get_cpuset_group_cpus(group);
+      if(cpus.isSome()) {
+        occupancy.assign(group, cpus.get());
+      }
+    }
+  }
+
+  return occupancy.load(snapshot);
+}
@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  which containers sit on which cpus
+//
+//  the isolator's placement state, updated when a
+//  container is placed, re-placed or cleaned up. the
+//  scheduler's cost and weight vectors come from one
+//  load() of this index instead of a scan of every
+//  group under /sys/fs/cgroup/cpuset, so a placement
+//  reads no files. only the isolator's containers are
+//  counted; reconcile() re-reads their cpuset.cpus at
+//  recovery and on a slow timer.
+//
+//  every assign advances a version and stamps the
+//  cpus it took with it. a placement computed off
+//  the assigner's actor from load() at version v is
+//  claim()ed back on it: the claim fails if any of
+//  its cpus was taken after v, the placement is then
+//  computed again instead of double booking the
+//  cpu. cpus freed meanwhile don't fail a claim.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCOREOCCUPANCY__
+#define __MESOSCOREOCCUPANCY__ 1
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <valarray>
+#include <vector>
+
+#include <stout/option.hpp>
+
+#include "CoreMask.hpp"
+#include "TopologySnapshot.hpp"
+
+// the scheduler's view of the load on each
+// logical core, taken at one point in time
+struct CoreLoad {
+
+  // tasks per core, the root group counts as
+  // one, +inf for cores the agent can't use
+  std::valarray<float> cost;
+
+  // free capacity, pus / cost per core, 0 for
+  // unusable cores; an idle core covers its
+  // neighbours more than a busy one
+  std::valarray<float> weights;
+};
+
+class CoreOccupancy {
+
+public:
+
+  CoreOccupancy();
+
+  // the container now runs on 'cpus' (os
+  // numbers), replacing what it had
+  void assign(const std::string& container, const CoreMask& cpus);
+
+  void release(const std::string& container);
+
+  // assign, unless one of 'cpus' was assigned
+  // to after version 'seen'
+  bool claim(
+    const std::string& container,
+    const CoreMask& cpus,
+    const uint64_t seen);
+
+  // advanced by every assign
+  uint64_t version() const;
+
+  Option<CoreMask> cpus(const std::string& container) const;
+
+  std::vector<std::string> containers() const;
+
+  // containers on an os cpu
+  int holders(const int cpu) const;
+
+  // 'except' doesn't count, its placement
+  // is being replaced
+  CoreLoad load(
+    const TopologySnapshot& snapshot,
+    const std::string& except = std::string()) const;
+
+private:
+
+  std::map<std::string, CoreMask> containerCpus;
+
+  // containers per os cpu
+  std::vector<int> cpuHolders;
+
+  // version of the last assign to each os cpu
+  uint64_t currentVersion;
+  std::vector<uint64_t> cpuVersions;
+
+};
+
+// the load of every group under the cpuset
+// root, for placements without an index
+CoreLoad scan_core_load(const TopologySnapshot& snapshot);
+
+#endif
@@ -0,0 +1,102 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  incremental state for the coverage function
+//
+//  L(S) = sum_{i in V} min( C_i(S), alpha * C_i(V) )
+//  C_i(S) = sum_{j in S} w_j * sim(i, j)
+//
+//  from "A Class of Submodular Functions for Document
+//  Summarization" by Lin and Bilmes.
+//
+//  the state keeps C_i(G) and alpha * C_i(V) for every
+//  core i, so the gain of adding a core to G and the
+//  update after adding it are both one pass over a row
+//  of the similarity matrix. cores outside of V have
+//  a capacity of 0 and never add to L.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCOVERAGESTATE__
+#define __MESOSCOVERAGESTATE__ 1
+
+#include <valarray>
+#include <algorithm>
+
+#include "stout/foreach.hpp"
+
+#include "CoreMask.hpp"
+#include "SimilarityMatrix.hpp"
+
+class CoverageState {
+
+public:
+
+  CoverageState(
+    const SimilarityMatrix& sim_,
+    const std::valarray<float>& weights_,
+    const CoreMask& V,
+    const float alpha = 1.0)
+    : sim(sim_),
+      weights(weights_),
+      cover(sim_.width()),
+      cap(sim_.width()),
+      total(0.0) {
+
+    AlignedFloats zero(sim.width());
+
+    foreach(int j, V) {
+      coverage_add(sim.row(j), weights[j], cap.get(), zero.get(), sim.width());
+    }
+
+    for(int i = 0; i < sim.width(); i++) {
+      cap[i] = V.count(i) ? (alpha * cap[i]) : 0.0;
+    }
+  }
+
+  // L(G)
+  float value() const {
+    return total;
+  }
+
+  // L(G u {l}) - L(G)
+  float gain(const int l) const {
+    return coverage_gain(sim.row(l), weights[l], cover.get(), cap.get(), sim.width());
+  }
+
+  // G = G u {l}
+  void add(const int l) {
+    total = coverage_add(sim.row(l), weights[l], cover.get(), cap.get(), sim.width());
+  }
+
+private:
+
+  const SimilarityMatrix& sim;
+
+  const std::valarray<float>& weights;
+
+  // C_i(G) for each core
+  AlignedFloats cover;
+
+  // alpha * C_i(V) for each core
+  AlignedFloats cap;
+
+  float total;
+
+};
+
+#endif
@@ -0,0 +1,206 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "CpuList.hpp"
+
+static inline bool is_space(const char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// digits at buf[*pos], advances *pos
+static inline bool parse_index(
+  const char* buf,
+  const size_t len,
+  size_t& pos,
+  int& value) {
+  const size_t start = pos;
+  value = 0;
+
+  while(pos < len && buf[pos] >= '0' && buf[pos] <= '9') {
+    value = (value * 10) + (buf[pos] - '0');
+    if(value >= CoreMask::CAPACITY) {
+      return false;
+    }
+
+    pos++;
+  }
+
+  return pos > start;
+}
+
+bool parse_cpulist(const char* buf, size_t len, CoreMask& mask) {
+  while(len > 0 && is_space(buf[len - 1])) {
+    len--;
+  }
+
+  size_t pos = 0;
+  while(pos < len) {
+    int lo = 0;
+    int hi = 0;
+
+    if(!parse_index(buf, len, pos, lo)) {
+      return false;
+    }
+
+    hi = lo;
+    if(pos < len && buf[pos] == '-') {
+      pos++;
+      if(!parse_index(buf, len, pos, hi) || hi < lo) {
+        return false;
+      }
+    }
+
+    mask.insert(lo, hi);
+
+    if(pos < len) {
+      // a separator needs something after it
+      if(buf[pos] != ',' || pos + 1 == len) {
+        return false;
+      }
+
+      pos++;
+    }
+  }
+
+  return true;
+}
+
+// decimal index at buf + pos, written back to
+// front, returns the new end or -1 if it doesn't fit
+static inline int format_index(
+  int value,
+  char* buf,
+  const size_t len,
+  size_t pos) {
+  const size_t n = (value < 10) ? 1 : (value < 100) ? 2 : (value < 1000) ? 3 : 4;
+
+  if(pos + n > len) {
+    return -1;
+  }
+
+  for(size_t d = pos + n; d > pos; value /= 10) {
+    buf[--d] = '0' + (value % 10);
+  }
+
+  return static_cast<int>(pos + n);
+}
+
+int format_cpulist(const CoreMask& mask, char* buf, const size_t len) {
+  int pos = 0;
+
+  for(int lo = mask.first(); lo >= 0; ) {
+    const int hi = mask.nextClear(lo) - 1;
+
+    if(pos > 0) {
+      if(static_cast<size_t>(pos) >= len) { return -1; }
+      buf[pos++] = ',';
+    }
+
+    pos = format_index(lo, buf, len, pos);
+    if(pos < 0) { return -1; }
+
+    if(hi > lo) {
+      if(static_cast<size_t>(pos) >= len) { return -1; }
+      buf[pos++] = '-';
+
+      pos = format_index(hi, buf, len, pos);
+      if(pos < 0) { return -1; }
+    }
+
+    lo = mask.next(hi);
+  }
+
+  return pos;
+}
+
+Try<CoreMask> read_cpulist(const char* path) {
+  char buf[CPULIST_BUFSIZE];
+  size_t len = 0;
+
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    return ErrnoError(std::string("failed to open ") + path);
+  }
+
+  while(len < sizeof(buf)) {
+    const ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if(n < 0) {
+      const ErrnoError error(std::string("failed to read ") + path);
+      close(fd);
+      return error;
+    }
+
+    if(n == 0) {
+      break;
+    }
+
+    len += n;
+  }
+
+  close(fd);
+
+  CoreMask mask;
+  if(!parse_cpulist(buf, len, mask)) {
+    return Error(std::string("malformed cpu list in ") + path);
+  }
+
+  return mask;
+}
+
+Try<Nothing> write_cpulist(const char* path, const CoreMask& mask) {
+  char buf[CPULIST_BUFSIZE + 1];
+
+  const int len = format_cpulist(mask, buf, CPULIST_BUFSIZE);
+  if(len < 0) {
+    return Error(std::string("cpu list too long for ") + path);
+  }
+
+  // an empty list still has to be written
+  buf[len] = '\n';
+
+  const int fd = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+  if(fd < 0) {
+    return ErrnoError(std::string("failed to open ") + path);
+  }
+
+  ssize_t n = 0;
+  do {
+    n = write(fd, buf, len + 1);
+  } while(n < 0 && errno == EINTR);
+
+  if(n != len + 1) {
+    const ErrnoError error(std::string("failed to write ") + path);
+    close(fd);
+    return error;
+  }
+
+  close(fd);
+  return Nothing();
+}
@@ -0,0 +1,57 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  kernel cpu/node lists, "0-3,8,10-11"
+//
+//  cpuset.cpus, cpuset.mems, cpuset.effective_cpus and
+//  /sys/devices/system/cpu/online all use this format.
+//  occupancy scans parse one for every cgroup, so the
+//  parser and formatter work on a stack buffer and a
+//  CoreMask, a file is one open, read() and close and
+//  nothing is allocated unless there is an error.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCPULIST__
+#define __MESOSCPULIST__ 1
+
+#include <cstddef>
+
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+#include "CoreMask.hpp"
+
+// longest list of CoreMask::CAPACITY cpus, every
+// other cpu set, 4 digits and a comma each
+static const size_t CPULIST_BUFSIZE = 16384;
+
+// adds the cpus in buf[0, len) to mask. trailing
+// whitespace is ignored and an empty list is valid,
+// false on anything malformed or out of range
+bool parse_cpulist(const char* buf, const size_t len, CoreMask& mask);
+
+// writes mask as ranges, without a terminator,
+// returns the length or -1 if buf is too small
+int format_cpulist(const CoreMask& mask, char* buf, const size_t len);
+
+Try<CoreMask> read_cpulist(const char* path);
+
+// one write(), as cgroup files expect
+Try<Nothing> write_cpulist(const char* path, const CoreMask& mask);
+
+#endif
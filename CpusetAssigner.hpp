@@ -4,74 +4,663 @@
 #include "cgroupcpusets.hpp"
 #include "TopologyResourceInformation.hpp"
 #include "SubmodularScheduler.hpp"
+#include "GpuPlacement.hpp"
+#include "CoreOccupancy.hpp"
+#include "CpusetWatcher.hpp"
+#include "CpusetIo.hpp"
+#include "CpusetPlacer.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
 #include <mesos/resources.hpp>
 
+#include <process/collect.hpp>
+#include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
+#include <process/io.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/lambda.hpp>
+#include <stout/stringify.hpp>
 #include <stout/try.hpp>
 #include <stout/path.hpp>
+#include <stout/foreach.hpp>
+
+// claims lost to other placements before the
+// cores are chosen on the assigner's actor
+static const int MAX_PLACEMENT_ATTEMPTS = 4;
 
 class CpusetAssignerProcess : public process::Process<CpusetAssignerProcess> {
 
 public:
-  CpusetAssignerProcess() {
+  CpusetAssignerProcess(
+    const SubmodularSchedulerOptions& options = SubmodularSchedulerOptions(),
+    const Duration& reconcileInterval_ = Minutes(1),
+    const size_t poolSize_ = 0,
+    const size_t ioWorkers_ = 2,
+    const size_t placementWorkers_ = 2)
+    : schedulerOptions(options),
+      reconcileInterval(reconcileInterval_),
+      poolSize(poolSize_),
+      ioWorkers(std::max<size_t>(ioWorkers_, 1)),
+      placementWorkers(std::max<size_t>(placementWorkers_, 1)),
+      placing(0),
+      placements(0) {
   }
 
   ~CpusetAssignerProcess() {
   }
 
+  // the cores are chosen on a placer against the
+  // occupancy as of when it gets to the container
+  // and claimed back here, then the group is
+  // written and the pid
+  // attached on the container's i/o actor. false
+  // when the cores or gpus aren't there or the
+  // cgroup i/o fails. 'allocatedGpus' are the
+  // bus ids of the gpus mesos gave the container,
+  // its cores go next to them
   process::Future<bool> assign(
     const mesos::ContainerID& containerId,
     const pid_t pid,
     const double ncpus_req,
-    const double ngpus_req) {
+    const double ngpus_req,
+    const std::string& ioDevice,
+    const std::vector<std::string>& allocatedGpus) {
+
+    const std::string containerIdStr = containerId.value();
+    const Option<CoreMask> previous = occupancy.cpus(containerIdStr);
+    const std::vector<std::string> previousGpus = gpuOccupancy.held(containerIdStr);
+
+    // a later placement of the same
+    // container supersedes this one
+    const uint64_t ticket = ++placements;
+    pending[containerIdStr] = ticket;
+
+    const process::PID<CpusetIoProcess> worker = ioFor(containerIdStr);
+
+    QueuedPlacement queued;
+    queued.container = containerIdStr;
+    queued.ncpus = ncpus_req;
+    queued.ngpus = ngpus_req;
+    queued.ioDevice = ioDevice;
+    queued.allocatedGpus = allocatedGpus;
+    queued.ticket = ticket;
+    queued.promise = process::Owned<process::Promise<CpusetPlacement> >(
+      new process::Promise<CpusetPlacement>());
+
+    waiting.push_back(queued);
+    startPlacements();
+
+    return queued.promise->future()
+      .then(process::defer(worker, &CpusetIoProcess::write,
+                           containerIdStr, lambda::_1))
+      .then(process::defer(worker, &CpusetIoProcess::attach,
+                           containerIdStr, pid, lambda::_1))
+      .then(process::defer(self(), &CpusetAssignerProcess::placed,
+                           containerIdStr, ticket, lambda::_1))
+      .repair(process::defer(self(), &CpusetAssignerProcess::failed,
+                             containerIdStr, ticket, previous, previousGpus, lambda::_1));
+  }
+
+  // the container's cores and gpus are free
+  // again and its group is released
+  process::Future<Nothing> release(const mesos::ContainerID& containerId) {
+    const std::string containerIdStr = containerId.value();
+
+    occupancy.release(containerIdStr);
+    gpuOccupancy.release(containerIdStr);
+    groupNames.erase(containerIdStr);
+    pending.erase(containerIdStr);
+
+    return process::dispatch(ioFor(containerIdStr),
+      &CpusetIoProcess::release,
+      containerIdStr);
+  }
+
+  // the cpus of the container's group as
+  // the kernel has them, none if it's gone
+  process::Future<Option<CoreMask> > cpus(const mesos::ContainerID& containerId) {
+    return process::dispatch(ioFor(containerId.value()),
+        &CpusetIoProcess::cpus,
+        std::vector<std::string>(1, containerId.value()))
+      .then(lambda::bind(&CpusetAssignerProcess::first, lambda::_1));
+  }
+
+  // re-read cpuset.cpus of 'containers' and of
+  // every indexed container, those whose group
+  // is gone are released
+  process::Future<Nothing> reconcile(const std::vector<std::string>& containers) {
+    std::vector<std::string> names = occupancy.containers();
+    names.insert(names.end(), containers.begin(), containers.end());
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    return readGroups(names)
+      .then(process::defer(self(), &CpusetAssignerProcess::reconciled,
+                           lambda::_1, true));
+  }
+
+  // the index and groups of containers an
+  // earlier agent placed, as their groups
+  // have them; none is placed again
+  process::Future<Nothing> recover(
+    const std::map<std::string, pid_t>& containers,
+    const std::set<std::string>& orphans) {
+    std::vector<std::map<std::string, pid_t> > shares(io.size());
+    for(std::map<std::string, pid_t>::const_iterator container = containers.begin();
+        container != containers.end(); ++container) {
+      shares[std::hash<std::string>()(container->first) % io.size()].insert(*container);
+    }
+
+    std::list<process::Future<std::map<std::string, RecoveredGroup> > > reads;
+    for(size_t w = 0; w < io.size(); w++) {
+      reads.push_back(process::dispatch(io[w]->self(), &CpusetIoProcess::recover, shares[w]));
+    }
+
+    return process::collect(reads)
+      .then(process::defer(self(), &CpusetAssignerProcess::recovered, orphans, lambda::_1));
+  }
+
+  void randCpuAssigner(
+    std::vector<int>& cores,
+    const int coreReq);
+
+protected:
+  virtual void initialize() {
+    Try<Nothing> removed = remove_idle_pool_groups();
+    if(removed.isError()) {
+      LOG(WARNING) << "Idle pool groups left: " << removed.error();
+    }
+
+    for(size_t w = 0; w < placementWorkers; w++) {
+      process::Owned<CpusetPlacerProcess> placer(new CpusetPlacerProcess(schedulerOptions));
+      spawn(placer.get());
+      placers.push_back(placer);
+    }
+
+    // each i/o actor gets a share of the pool
+    for(size_t w = 0; w < ioWorkers; w++) {
+      const size_t share = (poolSize / ioWorkers) + ((w < poolSize % ioWorkers) ? 1 : 0);
+      process::Owned<CpusetIoProcess> worker(new CpusetIoProcess(
+        share, CPUSET_POOL_PREFIX + stringify(w) + "-"));
+      spawn(worker.get());
+      io.push_back(worker);
+    }
+
+    if(reconcileInterval > Seconds(0)) {
+      process::delay(reconcileInterval, self(), &CpusetAssignerProcess::reconcileTimer);
+    }
+
+    Try<Nothing> watching = watcher.start(cpuset_backend().root());
+    if(watching.isError()) {
+      LOG(WARNING) << "Not watching the cpuset hierarchy: " << watching.error();
+      return;
+    }
+
+    watchCgroups();
+  }
+
+  virtual void finalize() {
+    foreach(const process::Owned<CpusetPlacerProcess>& placer, placers) {
+      terminate(placer.get());
+      wait(placer.get());
+    }
+
+    foreach(const process::Owned<CpusetIoProcess>& worker, io) {
+      terminate(worker.get());
+      wait(worker.get());
+    }
+  }
+
+private:
+  // a placement waiting for a placer
+  struct QueuedPlacement {
+    std::string container;
+    double ncpus;
+    double ngpus;
+    std::string ioDevice;
+    std::vector<std::string> allocatedGpus;
+    uint64_t ticket;
+    process::Owned<process::Promise<CpusetPlacement> > promise;
+  };
+
+  // a placement per placer at a time; one taken
+  // as it's queued would be chosen against the
+  // same load as the whole burst queued with it
+  // and lose most of its claims
+  void startPlacements() {
+    while(placing < placers.size() && !waiting.empty()) {
+      const QueuedPlacement queued = waiting.front();
+      waiting.pop_front();
+
+      if(!pending.count(queued.container) || pending[queued.container] != queued.ticket) {
+        queued.promise->fail("placement superseded");
+        continue;
+      }
+
+      placing++;
+
+      queued.promise->associate(place(
+        request(queued.container, queued.ncpus, queued.ngpus, queued.ioDevice,
+                queued.allocatedGpus),
+        queued.ticket,
+        0));
+
+      queued.promise->future()
+        .onAny(process::defer(self(), &CpusetAssignerProcess::placementDone));
+    }
+  }
+
+  void placementDone() {
+    placing--;
+    startPlacements();
+  }
+
+  // the container's request against the
+  // occupancy as of this turn
+  PlacementRequest request(
+    const std::string& containerIdStr,
+    const double ncpus_req,
+    const double ngpus_req,
+    const std::string& ioDevice,
+    const std::vector<std::string>& allocatedGpus) const {
+    const std::shared_ptr<const TopologySnapshot> pinned = HwlocTopology::snapshot();
+    const TopologySnapshot& snapshot = *pinned;
 
-    const double ncpus = static_cast<double>(loc.nCores().get()) * ncpus_req;
-    std::set<int> cpuset_to_assign;
+    PlacementRequest request;
+    request.container = containerIdStr;
+    request.ncpus = ncpus_req;
+    request.ngpus = ngpus_req;
+    request.ioDevice = ioDevice;
+    request.allocatedGpus = allocatedGpus;
+    request.load = occupancy.load(snapshot, containerIdStr);
+    request.version = occupancy.version();
+    request.generation = snapshot.generation;
 
+    // a re-placement gives its gpus back first
     if(ngpus_req > 0.0) {
-      SubmodularScheduler<CudaTopologyResourceInformationPolicy> scheduler;
-      scheduler(cpuset_to_assign, ncpus, ngpus_req);
+      request.gpus = gpuOccupancy;
+      request.gpus.release(containerIdStr);
+    }
+
+    return request;
+  }
+
+  // placements run on the placers side by side,
+  // the last attempt runs here against this
+  // turn's occupancy; it only loses to a topology
+  // change, and then the assign fails rather than
+  // write cores nobody reserved
+  process::Future<CpusetPlacement> place(
+    const PlacementRequest& request,
+    const uint64_t ticket,
+    const int attempt) {
+    if(attempt + 1 >= MAX_PLACEMENT_ATTEMPTS) {
+      Try<CpusetPlacement> placement =
+        CpusetPlacerProcess::schedule(schedulerOptions, request);
+
+      if(placement.isError()) {
+        return process::Failure(placement.error());
+      }
+
+      if(!reserve(request, placement.get())) {
+        return process::Failure(
+          "could not reserve a placement after " +
+          stringify(MAX_PLACEMENT_ATTEMPTS) + " attempts");
+      }
+
+      return placement.get();
+    }
+
+    const process::PID<CpusetPlacerProcess> placer =
+      placers[(ticket + attempt) % placers.size()]->self();
+
+    return process::dispatch(placer, &CpusetPlacerProcess::place, request)
+      .then(process::defer(self(), &CpusetAssignerProcess::claim,
+                           request, ticket, attempt, lambda::_1));
+  }
+
+  // the placer's choice, if its cores and gpus
+  // are still as the request saw them
+  process::Future<CpusetPlacement> claim(
+    const PlacementRequest& request,
+    const uint64_t ticket,
+    const int attempt,
+    const Option<CpusetPlacement>& placement) {
+    const std::string& container = request.container;
+
+    if(!pending.count(container) || pending[container] != ticket) {
+      return process::Failure("placement superseded");
+    }
+
+    if(placement.isSome() && reserve(request, placement.get())) {
+      return placement.get();
+    }
+
+    // lost to a placement claimed meanwhile,
+    // placed again against the occupancy now
+    return place(
+      this->request(container, request.ncpus, request.ngpus, request.ioDevice,
+                    request.allocatedGpus),
+      ticket,
+      attempt + 1);
+  }
+
+  // compare and swap against the occupancy, the
+  // container gets the placement's cores and gpus
+  // unless another placement took one since the
+  // request's version
+  bool reserve(const PlacementRequest& request, const CpusetPlacement& placement) {
+    const std::string& container = request.container;
+
+    if(request.generation != HwlocTopology::snapshot()->generation) {
+      return false;
     }
-    else {
-      SubmodularScheduler<CpuTopologyResourceInformationPolicy> scheduler;
-      scheduler(cpuset_to_assign, ncpus_req);
+
+    // mesos keeps the gpus it allocated to one
+    // container, those chosen here are checked
+    if(request.allocatedGpus.empty()) {
+      const std::vector<std::string> held = gpuOccupancy.held(container);
+      foreach(const std::string& busid, placement.gpus) {
+        const bool own = std::find(held.begin(), held.end(), busid) != held.end();
+        if(gpuOccupancy.holders(busid) - (own ? 1 : 0) > 0) {
+          return false;
+        }
+      }
     }
 
-    if(cpuset_to_assign.size() < ncpus_req) {
+    if(!occupancy.claim(container, placement.cpus, request.version)) {
       return false;
     }
 
-    std::vector<int> cpuset;
-    std::copy(std::begin(cpuset_to_assign), std::end(cpuset_to_assign), std::begin(cpuset));
+    if(request.ngpus > 0.0 || !request.allocatedGpus.empty()) {
+      gpuOccupancy.release(container);
+    }
 
-    std::vector<int> cpumem;
-    std::for_each(std::begin(cpuset), std::end(cpuset),
-      [&cpumem, this] (int cpu_os_id) { 
-        cpumem.push_back(this->loc.getNumaForCore(cpu_os_id).get());
-    });
+    foreach(const std::string& busid, placement.gpus) {
+      gpuOccupancy.hold(busid, container);
+      LOG(INFO) << "Container " << container << " gets gpu " << busid;
+    }
 
-    const std::string containerIdStr = containerId.value();
-    assign_cpuset_group_cpus(containerIdStr, cpuset);
-    assign_cpuset_group_mems(containerIdStr, cpumem);
-    attach_cpuset_group_pid(containerIdStr, pid);
-    
     return true;
   }
 
-  void randCpuAssigner(
-    std::vector<int>& cores,
-    const int coreReq);
+  bool placed(
+    const std::string& container,
+    const uint64_t ticket,
+    const std::string& group) {
+    if(pending.count(container) && pending[container] == ticket) {
+      pending.erase(container);
+      groupNames[container] = group;
+    }
 
-private:
-  TopologyResourceInformation loc;
+    return true;
+  }
+
+  // the write or attach failed, the container
+  // goes back to what it held before
+  process::Future<bool> failed(
+    const std::string& container,
+    const uint64_t ticket,
+    const Option<CoreMask>& previous,
+    const std::vector<std::string>& previousGpus,
+    const process::Future<bool>& future) {
+    LOG(WARNING) << "Container " << container << ": "
+                 << (future.isFailed() ? future.failure() : "placement discarded");
+
+    if(pending.count(container) && pending[container] == ticket) {
+      pending.erase(container);
+      restore(container, previous, previousGpus);
+    }
+
+    return false;
+  }
+
+  void restore(
+    const std::string& container,
+    const Option<CoreMask>& cpus,
+    const std::vector<std::string>& gpus) {
+    occupancy.release(container);
+    if(cpus.isSome()) {
+      occupancy.assign(container, cpus.get());
+    }
+
+    gpuOccupancy.release(container);
+    foreach(const std::string& busid, gpus) {
+      gpuOccupancy.hold(busid, container);
+    }
+  }
+
+  const process::PID<CpusetIoProcess> ioFor(const std::string& container) const {
+    return io[std::hash<std::string>()(container) % io.size()]->self();
+  }
+
+  // the containers' groups read on their
+  // i/o actors, one map
+  process::Future<std::map<std::string, Option<CoreMask> > > readGroups(
+    const std::vector<std::string>& containers) {
+    std::vector<std::vector<std::string> > shares(io.size());
+    foreach(const std::string& container, containers) {
+      shares[std::hash<std::string>()(container) % io.size()].push_back(container);
+    }
+
+    std::list<process::Future<std::map<std::string, Option<CoreMask> > > > reads;
+    for(size_t w = 0; w < io.size(); w++) {
+      reads.push_back(process::dispatch(io[w]->self(), &CpusetIoProcess::cpus, shares[w]));
+    }
+
+    return process::collect(reads)
+      .then(lambda::bind(&CpusetAssignerProcess::merge, lambda::_1));
+  }
+
+  static std::map<std::string, Option<CoreMask> > merge(
+    const std::list<std::map<std::string, Option<CoreMask> > >& reads) {
+    std::map<std::string, Option<CoreMask> > merged;
+    for(std::list<std::map<std::string, Option<CoreMask> > >::const_iterator read = reads.begin();
+        read != reads.end(); ++read) {
+      merged.insert(read->begin(), read->end());
+    }
+
+    return merged;
+  }
+
+  // gpus aren't in a cpuset, a recovered
+  // container's are not held. the unpopulated
+  // groups of orphans are removed, their cpus
+  // would otherwise stay counted as busy until
+  // the containerizer destroys them. groups of
+  // containers the agent doesn't know are left
+  // alone, they may not be the agent's
+  process::Future<Nothing> recovered(
+    const std::set<std::string>& orphans,
+    const std::list<std::map<std::string, RecoveredGroup> >& reads) {
+    for(std::list<std::map<std::string, RecoveredGroup> >::const_iterator read = reads.begin();
+        read != reads.end(); ++read) {
+      for(std::map<std::string, RecoveredGroup>::const_iterator group = read->begin();
+          group != read->end(); ++group) {
+        occupancy.assign(group->first, group->second.cpus);
+        groupNames[group->first] = group->second.group;
+      }
+    }
+
+    std::vector<std::vector<std::string> > shares(io.size());
+    foreach(const std::string& orphan, orphans) {
+      if(groupNames.count(orphan)) {
+        shares[std::hash<std::string>()(orphan) % io.size()].push_back(orphan);
+      }
+    }
+
+    std::list<process::Future<std::vector<std::string> > > removals;
+    for(size_t w = 0; w < io.size(); w++) {
+      removals.push_back(process::dispatch(io[w]->self(), &CpusetIoProcess::removeIdle, shares[w]));
+    }
+
+    return process::collect(removals)
+      .then(process::defer(self(), &CpusetAssignerProcess::removedIdle, lambda::_1));
+  }
+
+  // orphans whose group went at recovery
+  Nothing removedIdle(const std::list<std::vector<std::string> >& removals) {
+    for(std::list<std::vector<std::string> >::const_iterator removed = removals.begin();
+        removed != removals.end(); ++removed) {
+      foreach(const std::string& container, *removed) {
+        occupancy.release(container);
+        groupNames.erase(container);
+      }
+    }
+
+    return Nothing();
+  }
+
+  static Option<CoreMask> first(const std::map<std::string, Option<CoreMask> >& read) {
+    return read.empty() ? Option<CoreMask>(None()) : read.begin()->second;
+  }
+
+  // the kernel's view into the index. containers
+  // with a placement in flight keep their
+  // reservation; 'adopt' takes in containers
+  // the index doesn't have (recovery)
+  Nothing reconciled(
+    const std::map<std::string, Option<CoreMask> >& groups,
+    const bool adopt) {
+    for(std::map<std::string, Option<CoreMask> >::const_iterator group = groups.begin();
+        group != groups.end(); ++group) {
+      const std::string& container = group->first;
+
+      if(pending.count(container)) {
+        continue;
+      }
+
+      if(group->second.isNone()) {
+        if(adopt) {
+          occupancy.release(container);
+          gpuOccupancy.release(container);
+        }
+        continue;
+      }
+
+      if(adopt || occupancy.cpus(container).isSome()) {
+        occupancy.assign(container, group->second.get());
+      }
+    }
+
+    return Nothing();
+  }
+
+  void watchCgroups() {
+    process::io::poll(watcher.fd(), process::io::READ)
+      .onAny(process::defer(self(), &CpusetAssignerProcess::cgroupsChanged));
+  }
+
+  // a pooled group has its own name
+  std::string containerOf(const std::string& group) const {
+    for(std::map<std::string, std::string>::const_iterator g = groupNames.begin();
+        g != groupNames.end(); ++g) {
+      if(g->second == group) {
+        return g->first;
+      }
+    }
+
+    return group;
+  }
+
+  // a removed or emptied group frees its cores
+  // for the next placement right away, a write
+  // to cpuset.cpus from outside is picked up
+  void cgroupsChanged() {
+    std::vector<std::string> changed;
+
+    foreach(const CpusetEvent& event, watcher.read()) {
+      const std::string container = containerOf(event.group);
+
+      switch(event.kind) {
+        case CpusetEvent::REMOVED:
+        case CpusetEvent::EMPTIED:
+          if(!pending.count(container)) {
+            occupancy.release(container);
+            gpuOccupancy.release(container);
+          }
+          break;
+
+        case CpusetEvent::CPUS_CHANGED:
+          if(occupancy.cpus(container).isSome()) {
+            changed.push_back(container);
+          }
+          break;
+
+        case CpusetEvent::CREATED:
+          break;
+      }
+    }
+
+    if(!changed.empty()) {
+      readGroups(changed)
+        .then(process::defer(self(), &CpusetAssignerProcess::reconciled,
+                             lambda::_1, false));
+    }
+
+    watchCgroups();
+  }
+
+  void reconcileTimer() {
+    reconcile(std::vector<std::string>());
+    process::delay(reconcileInterval, self(), &CpusetAssignerProcess::reconcileTimer);
+  }
+
+  const SubmodularSchedulerOptions schedulerOptions;
+
+  // containers per cpu, the scheduler's load
+  CoreOccupancy occupancy;
+
+  // containers per gpu, exclusive by default
+  GpuOccupancy gpuOccupancy;
+
+  // sysfs is re-read this often, 0 never
+  const Duration reconcileInterval;
+
+  // group changes between reconciles
+  CpusetWatcher watcher;
+
+  // groups created ahead of containers, split
+  // over the i/o actors
+  const size_t poolSize;
+
+  // cgroup writes run here, a container
+  // always on the same one
+  const size_t ioWorkers;
+  std::vector<process::Owned<CpusetIoProcess> > io;
+
+  // cores are chosen here, a
+  // placement at a time each
+  const size_t placementWorkers;
+  std::vector<process::Owned<CpusetPlacerProcess> > placers;
+
+  // placements on the placers, and
+  // those waiting for one
+  size_t placing;
+  std::deque<QueuedPlacement> waiting;
+
+  // the latest placement of each container
+  // whose group isn't written yet
+  uint64_t placements;
+  std::map<std::string, uint64_t> pending;
+
+  // container -> group, differ for pooled groups
+  std::map<std::string, std::string> groupNames;
 
 };
 
@@ -79,20 +668,58 @@ class CpusetAssigner {
 
 public:
 
-  CpusetAssigner() {
+  CpusetAssigner(
+    const SubmodularSchedulerOptions& options = SubmodularSchedulerOptions(),
+    const Duration& reconcileInterval = Minutes(1),
+    const size_t poolSize = 0,
+    const size_t ioWorkers = 2,
+    const size_t placementWorkers = 2)
+    : process(options, reconcileInterval, poolSize, ioWorkers, placementWorkers) {
+    spawn(process);
   }
 
   process::Future<bool> assign(
     const mesos::ContainerID& containerId,
     const pid_t pid,
     const float ncpus_req,
-    const float ngpus_req) {
+    const float ngpus_req,
+    const std::string& ioDevice = std::string(),
+    const std::vector<std::string>& allocatedGpus = std::vector<std::string>()) {
     return dispatch(process,
       &CpusetAssignerProcess::assign,
       containerId,
       pid,
       ncpus_req,
-      ngpus_req);
+      ngpus_req,
+      ioDevice,
+      allocatedGpus);
+  }
+
+  process::Future<Nothing> release(const mesos::ContainerID& containerId) {
+    return dispatch(process,
+      &CpusetAssignerProcess::release,
+      containerId);
+  }
+
+  process::Future<Option<CoreMask> > cpus(const mesos::ContainerID& containerId) {
+    return dispatch(process,
+      &CpusetAssignerProcess::cpus,
+      containerId);
+  }
+
+  process::Future<Nothing> reconcile(const std::vector<std::string>& containers) {
+    return dispatch(process,
+      &CpusetAssignerProcess::reconcile,
+      containers);
+  }
+
+  process::Future<Nothing> recover(
+    const std::map<std::string, pid_t>& containers,
+    const std::set<std::string>& orphans) {
+    return dispatch(process,
+      &CpusetAssignerProcess::recover,
+      containers,
+      orphans);
   }
 
   ~CpusetAssigner() {
@@ -0,0 +1,255 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "CpusetGroup.hpp"
+#include "CpuList.hpp"
+#include "cgroupcpusets.hpp"
+
+CpusetGroup::CpusetGroup()
+  : dirFd(-1),
+    cpusFd(-1),
+    memsFd(-1),
+    procsFd(-1),
+    regular(false) {
+}
+
+CpusetGroup::~CpusetGroup() {
+  close();
+}
+
+// a plain directory tree standing in for the
+// hierarchy has no control files until written
+static inline int open_control(
+  const int dirFd,
+  const std::string& file,
+  const bool regular) {
+  return regular ?
+    openat(dirFd, file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644) :
+    openat(dirFd, file.c_str(), O_WRONLY | O_CLOEXEC);
+}
+
+Try<Nothing> CpusetGroup::open(const std::string& group_, const Mode mode) {
+  close();
+
+  CpusetBackend& backend = cpuset_backend();
+  const int rootFd = backend.rootFd();
+  if(rootFd < 0) {
+    return ErrnoError("failed to open " + backend.root());
+  }
+
+  if(mode != EXISTING && mkdirat(rootFd, group_.c_str(), 0755) < 0 &&
+     (mode == EXCLUSIVE || errno != EEXIST)) {
+    return ErrnoError("failed to create " + group_);
+  }
+
+  dirFd = openat(rootFd, group_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if(dirFd < 0) {
+    return ErrnoError("failed to open " + group_);
+  }
+
+  group = group_;
+  mems = None();
+
+  // cgroupfs files are S_ISREG too
+  struct statfs fs;
+  regular = (fstatfs(dirFd, &fs) == 0) &&
+    fs.f_type != CGROUP_SUPER_MAGIC && fs.f_type != CGROUP2_SUPER_MAGIC;
+
+  cpusFd = open_control(dirFd, "cpuset.cpus", regular);
+  memsFd = open_control(dirFd, "cpuset.mems", regular);
+  procsFd = open_control(dirFd, backend.procsFile(), regular);
+
+  if(cpusFd < 0 || memsFd < 0 || procsFd < 0) {
+    ErrnoError error("failed to open the control files of " + group);
+    close();
+    return error;
+  }
+
+  return Nothing();
+}
+
+void CpusetGroup::close() {
+  int* fds[] = { &procsFd, &memsFd, &cpusFd, &dirFd };
+
+  for(size_t f = 0; f < sizeof(fds) / sizeof(fds[0]); f++) {
+    if(*fds[f] >= 0) {
+      ::close(*fds[f]);
+      *fds[f] = -1;
+    }
+  }
+}
+
+// control files ignore the offset, pwrite at 0
+// keeps a plain file's contents to one write too
+Try<Nothing> CpusetGroup::write(
+  const int fd,
+  const char* buf,
+  const int len,
+  const char* file) {
+  if(fd < 0) {
+    return Error(group + " is not open");
+  }
+
+  if(regular && ftruncate(fd, 0) < 0) {
+    return ErrnoError(std::string("failed to truncate ") + file);
+  }
+
+  if(pwrite(fd, buf, len, 0) != len) {
+    return ErrnoError("failed to write " + group + "/" + file);
+  }
+
+  return Nothing();
+}
+
+Try<Nothing> CpusetGroup::writeCpus(const CoreMask& cpus) {
+  char buf[CPULIST_BUFSIZE];
+  const int len = format_cpulist(cpus, buf, sizeof(buf) - 1);
+  if(len < 0) {
+    return Error("cpu list too long");
+  }
+
+  buf[len] = '\n';
+
+  Try<Nothing> written = write(cpusFd, buf, len + 1, "cpuset.cpus");
+  if(written.isError()) {
+    return written;
+  }
+
+  return cpuset_backend().cpusWritten(group);
+}
+
+Try<Nothing> CpusetGroup::writeMems(const CoreMask& mems_) {
+  if(mems.isSome() && mems.get() == mems_) {
+    return Nothing();
+  }
+
+  char buf[CPULIST_BUFSIZE];
+  const int len = format_cpulist(mems_, buf, sizeof(buf) - 1);
+  if(len < 0) {
+    return Error("mem list too long");
+  }
+
+  buf[len] = '\n';
+
+  Try<Nothing> written = write(memsFd, buf, len + 1, "cpuset.mems");
+  if(written.isError()) {
+    mems = None();
+    return written;
+  }
+
+  mems = mems_;
+  return Nothing();
+}
+
+Try<CoreMask> CpusetGroup::read(const std::string& file) const {
+  if(dirFd < 0) {
+    return Error(group + " is not open");
+  }
+
+  const int fd = openat(dirFd, file.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    return ErrnoError("failed to open " + group + "/" + file);
+  }
+
+  char buf[CPULIST_BUFSIZE];
+  const ssize_t len = ::read(fd, buf, sizeof(buf));
+  ::close(fd);
+
+  if(len < 0) {
+    return ErrnoError("failed to read " + group + "/" + file);
+  }
+
+  CoreMask mask;
+  if(!parse_cpulist(buf, len, mask)) {
+    return Error("malformed list in " + group + "/" + file);
+  }
+
+  return mask;
+}
+
+Try<CoreMask> CpusetGroup::readCpus() const {
+  return read(cpuset_backend().groupCpusFile());
+}
+
+Try<CoreMask> CpusetGroup::readMems() {
+  Try<CoreMask> read_ = read("cpuset.mems");
+  mems = read_.isSome() ? Option<CoreMask>(read_.get()) : None();
+  return read_;
+}
+
+Try<bool> CpusetGroup::populated() const {
+  if(dirFd < 0) {
+    return Error(group + " is not open");
+  }
+
+  const std::string procs = cpuset_backend().procsFile();
+  const int fd = openat(dirFd, procs.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    return ErrnoError("failed to open " + group + "/" + procs);
+  }
+
+  char buf[32];
+  const ssize_t len = ::read(fd, buf, sizeof(buf));
+  ::close(fd);
+
+  if(len < 0) {
+    return ErrnoError("failed to read " + group + "/" + procs);
+  }
+
+  return len > 0;
+}
+
+Try<Nothing> CpusetGroup::attach(const pid_t pid) {
+  char buf[32];
+  const int len = snprintf(buf, sizeof(buf), "%d\n", static_cast<int>(pid));
+
+  return write(procsFd, buf, len, "cgroup.procs");
+}
+
+Try<Nothing> CpusetGroup::destroy() {
+  if(group.empty()) {
+    return Error("no group");
+  }
+
+  // the kernel removes a group's control
+  // files with it, a plain directory doesn't
+  if(regular && dirFd >= 0) {
+    const std::string files[] = { "cpuset.cpus", "cpuset.mems", cpuset_backend().procsFile() };
+    for(size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++) {
+      unlinkat(dirFd, files[f].c_str(), 0);
+    }
+  }
+
+  close();
+
+  if(unlinkat(cpuset_backend().rootFd(), group.c_str(), AT_REMOVEDIR) < 0) {
+    return ErrnoError("failed to remove " + group);
+  }
+
+  return Nothing();
+}
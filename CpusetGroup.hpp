@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  an open cpuset group
+//
+//  the group's directory is opened once, relative
+//  to the backend's root, and cpuset.cpus,
+//  cpuset.mems and cgroup.procs stay open until
+//  the container is gone. placing a container is
+//  then one write() per file: no path building, no
+//  stat, no open/close, and the pid goes to
+//  cgroup.procs so all of its threads move.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCPUSETGROUP__
+#define __MESOSCPUSETGROUP__ 1
+
+#include <sys/types.h>
+
+#include <string>
+
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include "CoreMask.hpp"
+
+class CpusetGroup {
+
+public:
+
+  CpusetGroup();
+
+  ~CpusetGroup();
+
+  enum Mode {
+    // the group exists
+    EXISTING,
+
+    // mkdir it unless it exists
+    CREATE,
+
+    // mkdir it, fail if it exists
+    EXCLUSIVE
+  };
+
+  // open 'group' under the backend's root
+  Try<Nothing> open(const std::string& group, const Mode mode);
+
+  void close();
+
+  bool isOpen() const {
+    return dirFd >= 0;
+  }
+
+  const std::string& name() const {
+    return group;
+  }
+
+  Try<Nothing> writeCpus(const CoreMask& cpus);
+
+  // skipped when 'mems' is what the group has
+  Try<Nothing> writeMems(const CoreMask& mems);
+
+  // what the group has now, read back at
+  // recovery; the mems read are not rewritten
+  Try<CoreMask> readCpus() const;
+  Try<CoreMask> readMems();
+
+  // a process is in the group
+  Try<bool> populated() const;
+
+  // the whole process, every thread
+  Try<Nothing> attach(const pid_t pid);
+
+  // close, then rmdir the group
+  Try<Nothing> destroy();
+
+private:
+
+  CpusetGroup(const CpusetGroup&);
+  CpusetGroup& operator=(const CpusetGroup&);
+
+  Try<Nothing> write(const int fd, const char* buf, const int len, const char* file);
+
+  Try<CoreMask> read(const std::string& file) const;
+
+  std::string group;
+
+  int dirFd;
+  int cpusFd;
+  int memsFd;
+  int procsFd;
+
+  // not on cgroupfs (a test tree), a plain file
+  // keeps what was written before, it is truncated;
+  // the control files are created and removed here
+  bool regular;
+
+  // the last mems written
+  Option<CoreMask> mems;
+
+};
+
+#endif
@@ -0,0 +1,344 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  cgroup filesystem i/o off the placement actor
+//
+//  a placement is computed by the assigner and
+//  written by one of a few CpusetIoProcess actors,
+//  so the assigner is free to place the next
+//  container while mkdir, the cpus/mems writes and
+//  the attach of the last one are in the kernel. a
+//  container always goes to the same i/o actor,
+//  which keeps its writes in order; each actor has
+//  its groups' open handles and its share of the
+//  group pool.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCPUSETIO__
+#define __MESOSCPUSETIO__ 1
+
+#include <sys/types.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/try.hpp>
+
+#include "cgroupcpusets.hpp"
+#include "CoreMask.hpp"
+#include "CpusetGroup.hpp"
+#include "CpusetPool.hpp"
+
+// what a container's group gets, os cpu
+// and numa node numbers
+struct CpusetPlacement {
+  CoreMask cpus;
+  CoreMask mems;
+
+  // pci bus ids, the group doesn't see them
+  std::vector<std::string> gpus;
+};
+
+// a running container's group as an
+// earlier agent left it
+struct RecoveredGroup {
+  std::string group;
+  CoreMask cpus;
+  CoreMask mems;
+};
+
+class CpusetIoProcess : public process::Process<CpusetIoProcess> {
+
+public:
+  CpusetIoProcess(const size_t poolSize, const std::string& poolPrefix)
+    : pool(poolSize, poolPrefix),
+      refilling(false) {
+  }
+
+  // the container's group, claimed from the
+  // pool or created, with the placement's cpus
+  // and mems; its name
+  process::Future<std::string> write(
+    const std::string& container,
+    const CpusetPlacement& placement) {
+    Try<CpusetGroup*> group = openGroup(container);
+    if(group.isError()) {
+      return process::Failure(group.error());
+    }
+
+    // mems before any pid, a v1 group
+    // without mems refuses tasks
+    Try<Nothing> written = group.get()->writeCpus(placement.cpus);
+    if(written.isSome()) {
+      written = group.get()->writeMems(placement.mems);
+    }
+
+    if(written.isError()) {
+      return process::Failure(written.error());
+    }
+
+    return group.get()->name();
+  }
+
+  // every thread of 'pid' into the group
+  process::Future<std::string> attach(
+    const std::string& container,
+    const pid_t pid,
+    const std::string& group) {
+    std::map<std::string, process::Owned<CpusetGroup> >::iterator open =
+      groups.find(container);
+    if(open == groups.end()) {
+      return process::Failure("no group for " + container);
+    }
+
+    Try<Nothing> attached = open->second->attach(pid);
+    if(attached.isError()) {
+      return process::Failure(attached.error());
+    }
+
+    return group;
+  }
+
+  // back to the pool, or removed
+  process::Future<Nothing> release(const std::string& container) {
+    std::map<std::string, process::Owned<CpusetGroup> >::iterator group =
+      groups.find(container);
+
+    if(group == groups.end()) {
+      // an orphan's idle group went at recovery
+      if(!os::exists(path::join(cpuset_backend().root(), container))) {
+        return Nothing();
+      }
+
+      Try<Nothing> destroyed = destroy_cpuset_group(container);
+      if(destroyed.isError()) {
+        LOG(WARNING) << "Container " << container << ": " << destroyed.error();
+      }
+      return Nothing();
+    }
+
+    if(pool.target() > 0) {
+      pool.put(group->second);
+    }
+    else {
+      Try<Nothing> destroyed = group->second->destroy();
+      if(destroyed.isError()) {
+        LOG(WARNING) << "Container " << container << ": " << destroyed.error();
+      }
+    }
+
+    groups.erase(group);
+    return Nothing();
+  }
+
+  // open the groups of containers an earlier
+  // agent placed and read back their cpus and
+  // mems, nothing is written: a running
+  // container stays on the cpus it has. a pid
+  // is found in its group through /proc, which
+  // also finds a pooled group; a pid of 0 or a
+  // pid outside the isolator's groups uses the
+  // group named after the container. a pid
+  // still at the root was never attached, the
+  // container is left for its update to place.
+  process::Future<std::map<std::string, RecoveredGroup> > recover(
+    const std::map<std::string, pid_t>& containers) {
+    std::map<std::string, RecoveredGroup> recovered;
+
+    for(std::map<std::string, pid_t>::const_iterator container = containers.begin();
+        container != containers.end(); ++container) {
+      Option<std::string> in = None();
+      if(container->second > 0) {
+        Try<std::string> group = get_pid_cpuset_group(container->second);
+        if(group.isSome()) {
+          in = group.get();
+        }
+      }
+
+      if(in.isSome() && in.get().empty()) {
+        continue;
+      }
+
+      // the root may sit below the hierarchy's
+      // top, its groups are its children
+      const std::string base = in.isSome() ?
+        in.get().substr(in.get().find_last_of('/') + 1) : std::string();
+
+      const bool attached = !base.empty() &&
+        (base == container->first ||
+         base.compare(0, CPUSET_POOL_PREFIX.size(), CPUSET_POOL_PREFIX) == 0);
+
+      const std::string name = attached ? base : container->first;
+
+      process::Owned<CpusetGroup> group(new CpusetGroup());
+      if(group->open(name, CpusetGroup::EXISTING).isError()) {
+        // it ran without a cpuset
+        continue;
+      }
+
+      Try<CoreMask> cpus = group->readCpus();
+      Try<CoreMask> mems = group->readMems();
+      if(cpus.isError() || mems.isError()) {
+        LOG(WARNING) << "Container " << container->first << ": "
+                     << (cpus.isError() ? cpus.error() : mems.error());
+        continue;
+      }
+
+      RecoveredGroup& found = recovered[container->first];
+      found.group = name;
+      found.cpus = cpus.get();
+      found.mems = mems.get();
+
+      groups[container->first] = group;
+    }
+
+    return recovered;
+  }
+
+  // unpopulated groups of orphans recovered on
+  // this actor are removed now, the containers
+  // whose group went are returned. a populated
+  // one waits for the orphan's destroy
+  process::Future<std::vector<std::string> > removeIdle(
+    const std::vector<std::string>& containers) {
+    std::vector<std::string> removed;
+
+    foreach(const std::string& container, containers) {
+      std::map<std::string, process::Owned<CpusetGroup> >::iterator group =
+        groups.find(container);
+
+      if(group == groups.end()) {
+        continue;
+      }
+
+      Try<bool> populated = group->second->populated();
+      if(populated.isError() || populated.get()) {
+        continue;
+      }
+
+      Try<Nothing> destroyed = group->second->destroy();
+      if(destroyed.isError()) {
+        LOG(WARNING) << "Container " << container << ": " << destroyed.error();
+        continue;
+      }
+
+      groups.erase(group);
+      removed.push_back(container);
+    }
+
+    return removed;
+  }
+
+  // the cpus of the containers' groups as the
+  // kernel has them, none for groups gone
+  process::Future<std::map<std::string, Option<CoreMask> > > cpus(
+    const std::vector<std::string>& containers) {
+    std::map<std::string, Option<CoreMask> > cpus;
+
+    foreach(const std::string& container, containers) {
+      std::map<std::string, process::Owned<CpusetGroup> >::const_iterator group =
+        groups.find(container);
+
+      Try<CoreMask> read = get_cpuset_group_cpus(
+        (group != groups.end()) ? group->second->name() : container);
+
+      cpus[container] = read.isSome() ? Option<CoreMask>(read.get()) : None();
+    }
+
+    return cpus;
+  }
+
+protected:
+  virtual void initialize() {
+    scheduleRefill();
+  }
+
+private:
+  Try<CpusetGroup*> openGroup(const std::string& container) {
+    std::map<std::string, process::Owned<CpusetGroup> >::iterator group =
+      groups.find(container);
+    if(group != groups.end()) {
+      return group->second.get();
+    }
+
+    Option<process::Owned<CpusetGroup> > pooled = pool.claim();
+    if(pooled.isSome()) {
+      groups[container] = pooled.get();
+      scheduleRefill();
+      return pooled.get().get();
+    }
+
+    process::Owned<CpusetGroup> opened(new CpusetGroup());
+    Try<Nothing> open = opened->open(container, CpusetGroup::CREATE);
+    if(open.isError()) {
+      return Error(open.error());
+    }
+
+    groups[container] = opened;
+    return opened.get();
+  }
+
+  // one group per message, writes
+  // queued meanwhile go first
+  void scheduleRefill() {
+    if(!refilling && !pool.full()) {
+      refilling = true;
+      process::dispatch(self(), &CpusetIoProcess::refillPool);
+    }
+  }
+
+  void refillPool() {
+    refilling = false;
+
+    if(pool.full()) {
+      return;
+    }
+
+    Try<Nothing> refilled = pool.refill();
+    if(refilled.isError()) {
+      // tried again on the next claim
+      LOG(WARNING) << "Cpuset pool refill failed: " << refilled.error();
+      return;
+    }
+
+    scheduleRefill();
+  }
+
+  // open groups of this actor's containers
+  std::map<std::string, process::Owned<CpusetGroup> > groups;
+
+  // groups ready for the next containers
+  CpusetPool pool;
+  bool refilling;
+
+};
+
+#endif
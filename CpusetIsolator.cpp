@@ -16,14 +16,52 @@
 
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
+#include <process/defer.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 
 #include "CpusetIsolator.hpp"
 
 #include <leveldb/write_batch.h>
+#include <map>
+#include <set>
 #include <string>
 
 using namespace process;
 
+static double requestedGpus(const mesos::Resources& resources) {
+  const Option<mesos::Value::Scalar> gpus =
+    resources.get<mesos::Value::Scalar>("gpus");
+  return gpus.isSome() ? gpus.get().value() : 0.0;
+}
+
+// the executor's 'cpuset.iodevice' label
+static Option<std::string> ioDeviceLabel(const mesos::ExecutorInfo& executorInfo) {
+  if(executorInfo.has_labels()) {
+    foreach(const mesos::Label& label, executorInfo.labels().labels()) {
+      if(label.key() == "cpuset.iodevice" && label.has_value()) {
+        return label.value();
+      }
+    }
+  }
+
+  return None();
+}
+
+// a container whose cores couldn't be
+// placed runs without a cpuset, as before
+static process::Future<Nothing> isolated(
+  const mesos::ContainerID& containerId,
+  const bool assigned) {
+  if(!assigned) {
+    LOG(WARNING) << "Container " << containerId
+                 << ": unable to allocate requested # of cores";
+  }
+
+  return Nothing();
+}
+
 static Result<process::Time> getCurrentTime(const double timewindow) {
   const Time now = Clock::now();
   const Duration dnow = now.duration();
@@ -48,6 +86,13 @@ CpusetIsolatorProcess::CpusetIsolatorProcess(
 {
   Option<std::string> odbpath;
   Option<std::string> otw;
+  Option<std::string> oeps;
+  Option<std::string> oseed;
+  Option<std::string> oreconcile;
+  Option<std::string> opoolsize;
+  Option<std::string> oioworkers;
+  Option<std::string> oplacementworkers;
+  Option<std::string> ogpudevicesroot;
 
   for(const mesos::Parameter& p : parameters.parameter()) {
     if(p.has_key() && (p.key() == "cpusetdbpath") && p.has_value()) {
@@ -56,8 +101,37 @@ CpusetIsolatorProcess::CpusetIsolatorProcess(
     else if(p.has_key() && (p.key() == "samplewindow") && p.has_value()) {
       otw = p.value();
     }
+    else if(p.has_key() && (p.key() == "stochasticepsilon") && p.has_value()) {
+      oeps = p.value();
+    }
+    else if(p.has_key() && (p.key() == "stochasticseed") && p.has_value()) {
+      oseed = p.value();
+    }
+    else if(p.has_key() && (p.key() == "iodevice") && p.has_value()) {
+      ioDevice = p.value();
+    }
+    else if(p.has_key() && (p.key() == "reconcileinterval") && p.has_value()) {
+      oreconcile = p.value();
+    }
+    else if(p.has_key() && (p.key() == "poolsize") && p.has_value()) {
+      opoolsize = p.value();
+    }
+    else if(p.has_key() && (p.key() == "ioworkers") && p.has_value()) {
+      oioworkers = p.value();
+    }
+    else if(p.has_key() && (p.key() == "placementworkers") && p.has_value()) {
+      oplacementworkers = p.value();
+    }
+    else if(p.has_key() && (p.key() == "gpudevicesroot") && p.has_value()) {
+      ogpudevicesroot = p.value();
+    }
   }
 
+  // where mesos' cgroups/devices/gpu/nvidia
+  // isolator puts the containers' devices groups
+  gpuDevicesRoot = ogpudevicesroot.isSome() ?
+    ogpudevicesroot.get() : "/sys/fs/cgroup/devices/mesos";
+
   const std::string dbpath = (odbpath.isSome()) ? odbpath.get() : os::getcwd();
   if(otw.isNone()) {
     perror("sample window not provided");
@@ -65,6 +139,44 @@ CpusetIsolatorProcess::CpusetIsolatorProcess(
   }
 
   timewindow = std::stod(otw.get());
+
+  if(oeps.isSome()) {
+    const float epsilon = std::stof(oeps.get());
+    if(epsilon <= 0.0 || epsilon >= 1.0) {
+      perror("stochastic epsilon must be in (0, 1)");
+      exit(-1);
+    }
+
+    schedulerOptions.mode = STOCHASTIC_GREEDY;
+    schedulerOptions.epsilon = epsilon;
+  }
+
+  if(oseed.isSome()) {
+    schedulerOptions.seed = static_cast<unsigned>(std::stoul(oseed.get()));
+  }
+
+  // the occupancy index is checked against
+  // sysfs this often, 0 disables
+  const Duration reconcileInterval = oreconcile.isSome() ?
+    Seconds(std::stod(oreconcile.get())) : Minutes(1);
+
+  // groups created ahead of launches, 0 creates
+  // each container's group at its isolate
+  const size_t poolSize = opoolsize.isSome() ?
+    static_cast<size_t>(std::stoul(opoolsize.get())) : 0;
+
+  // actors writing cgroups, placement
+  // continues while they do
+  const size_t ioWorkers = oioworkers.isSome() ?
+    static_cast<size_t>(std::stoul(oioworkers.get())) : 2;
+
+  // actors choosing cores side by side,
+  // their choices are claimed by the assigner
+  const size_t placementWorkers = oplacementworkers.isSome() ?
+    static_cast<size_t>(std::stoul(oplacementworkers.get())) : 2;
+
+  assigner.reset(new CpusetAssigner(
+    schedulerOptions, reconcileInterval, poolSize, ioWorkers, placementWorkers));
  
   leveldb::Options opts;
   opts.create_if_missing = true;
@@ -85,24 +197,149 @@ CpusetIsolatorProcess::CpusetIsolatorProcess(
 
 }
 
+void CpusetIsolatorProcess::initialize() {
+  watchTopology(HwlocTopology::snapshot()->generation);
+}
+
+void CpusetIsolatorProcess::watchTopology(const uint64_t generation) {
+  HwlocTopology::shared().changed(generation)
+    .onAny(process::defer(self(), &CpusetIsolatorProcess::topologyChanged, lambda::_1));
+}
+
+void CpusetIsolatorProcess::topologyChanged(
+  const process::Future<uint64_t>& generation) {
+  if(!generation.isReady()) {
+    LOG(WARNING) << "Stopped watching the cpu topology";
+    return;
+  }
+
+  foreachkey(const mesos::ContainerID& containerId, pids) {
+    if(!containerResources.contains(containerId)) {
+      continue;
+    }
+
+    // the assigner knows the container's group
+    assigner->cpus(containerId)
+      .onReady(process::defer(self(), &CpusetIsolatorProcess::coresChanged,
+                              containerId, lambda::_1));
+  }
+
+  watchTopology(generation.get());
+}
+
+void CpusetIsolatorProcess::coresChanged(
+  const mesos::ContainerID& containerId,
+  const Option<CoreMask>& cpus) {
+  if(cpus.isNone() || !pids.contains(containerId) ||
+     !containerResources.contains(containerId) ||
+     containerResources[containerId].cpus().isNone()) {
+    return;
+  }
+
+  const std::shared_ptr<const TopologySnapshot> pinned = HwlocTopology::snapshot();
+  const TopologySnapshot& snapshot = *pinned;
+
+  // the kernel drops offline cpus from the group,
+  // count what is left against the request
+  const CoreMask usable = cpus.get() & snapshot.onlineCpus;
+  const int cores = snapshot.getCoresForCpus(usable).size();
+  const double request = containerResources[containerId].cpus().get();
+
+  if(cores >= request) {
+    return;
+  }
+
+  LOG(INFO) << "Container " << containerId << " holds " << cores
+            << " of " << request << " cores, re-placing";
+
+  assigner->assign(containerId, pids[containerId], request,
+    requestedGpus(containerResources[containerId]),
+    ioDevices.contains(containerId) ? ioDevices[containerId] : ioDevice,
+    allocatedGpus(containerId));
+}
+
+void CpusetIsolatorProcess::recoveredCores(
+  const mesos::ContainerID& containerId,
+  const Option<CoreMask>& cpus) {
+  if(cpus.isSome()) {
+    coresChanged(containerId, cpus);
+    return;
+  }
+
+  if(!pids.contains(containerId) || !containerResources.contains(containerId) ||
+     containerResources[containerId].cpus().isNone()) {
+    return;
+  }
+
+  LOG(INFO) << "Container " << containerId << " was recovered without a cpuset, placing";
+
+  assigner->assign(containerId, pids[containerId],
+    containerResources[containerId].cpus().get(),
+    requestedGpus(containerResources[containerId]),
+    ioDevices.contains(containerId) ? ioDevices[containerId] : ioDevice,
+    allocatedGpus(containerId));
+}
+
+std::vector<std::string> CpusetIsolatorProcess::allocatedGpus(
+  const mesos::ContainerID& containerId) {
+  if(!containerResources.contains(containerId) ||
+     requestedGpus(containerResources[containerId]) <= 0.0) {
+    return std::vector<std::string>();
+  }
+
+  Try<std::vector<std::string> > gpus =
+    read_allocated_gpus(path::join(gpuDevicesRoot, containerId.value()));
+  if(gpus.isError()) {
+    LOG(WARNING) << "Container " << containerId
+                 << ": gpus mesos allocated not known, " << gpus.error();
+    return std::vector<std::string>();
+  }
+
+  return gpus.get();
+}
+
 process::Future<Nothing> CpusetIsolatorProcess::recover(
   const list<mesos::slave::ContainerState>& states,
   const hashset<mesos::ContainerID>& orphans) {
 
-/*
+  // the containers keep the cpus their groups
+  // have, the index starts from those
+  std::map<std::string, pid_t> containers;
+
   foreach (const mesos::slave::ContainerState& run, states) {
     if (pids.contains(run.container_id())) {
       return process::Failure("Container already recovered");
     }
 
     pids.put(run.container_id(), run.pid());
+    recovered.insert(run.container_id());
 
-    process::Owned<process::Promise<mesos::slave::ContainerLimitation>> promise(
-        new process::Promise<mesos::slave::ContainerLimitation>());
-    promises.put(run.container_id(), promise);
-  } */
+    // the executor's share until the
+    // agent's first update
+    containerResources.put(run.container_id(),
+      mesos::Resources(run.executor_info().resources()));
 
-  return Nothing();
+    const Option<std::string> label = ioDeviceLabel(run.executor_info());
+    if(label.isSome()) {
+      ioDevices.put(run.container_id(), label.get());
+    }
+
+    containers[run.container_id().value()] = run.pid();
+  }
+
+  // the containerizer destroys orphans, their
+  // cleanup removes the group they hold; an
+  // unpopulated one goes at recovery
+  std::set<std::string> orphaned;
+  foreach (const mesos::ContainerID& orphan, orphans) {
+    if (!containerResources.contains(orphan)) {
+      containerResources.put(orphan, mesos::Resources());
+      containers[orphan.value()] = 0;
+      orphaned.insert(orphan.value());
+    }
+  }
+
+  return assigner->recover(containers, orphaned);
 }
 
 process::Future<Option<mesos::slave::ContainerPrepareInfo>> CpusetIsolatorProcess::prepare(
@@ -121,6 +358,11 @@ process::Future<Option<mesos::slave::ContainerPrepareInfo>> CpusetIsolatorProces
 
   promises.put(containerId, promise);
 */
+  const Option<std::string> label = ioDeviceLabel(executorInfo);
+  if(label.isSome()) {
+    ioDevices.put(containerId, label.get());
+  }
+
   return None();
 
 }
@@ -152,37 +394,32 @@ process::Future<Nothing> CpusetIsolatorProcess::isolate(
   const mesos::ContainerID& containerId,
   pid_t pid)
 {
-  if(!pids.contains(containerId)) {
-    return process::Failure("Unknown container");
+  if(pids.contains(containerId)) {
+    return process::Failure("Container already isolated");
   }
 
   if(!containerResources.contains(containerId)) {
     return process::Failure("Unknown container resources");
   }
 
+  pids.put(containerId, pid);
+
   const mesos::Resources r = containerResources[containerId];
   const double cpus = r.cpus().get();
-  //const double gpus = r.gpus().get();
-  const double gpus = 0.0;
+  const double gpus = requestedGpus(r);
 
   updateDb(cpus);
 
-  create_cpuset_group(containerId.value());
-
-  CpusetAssigner cpuSetAssigner;
-
-  process::Future<bool> assigned = 
-    cpuSetAssigner.assign(
+  // ready once the pid is in its cpuset, the
+  // isolator's actor isn't held meanwhile
+  return assigner->assign(
       containerId,
       pid,
       cpus,
-      gpus);
-
-  if(assigned.isFailed()) {
-    return process::Failure("unable to allocate requested # of cores");
-  }
-
-  return Nothing();
+      gpus,
+      ioDevices.contains(containerId) ? ioDevices[containerId] : ioDevice,
+      allocatedGpus(containerId))
+    .then(lambda::bind(&isolated, containerId, lambda::_1));
 }
 
 
@@ -207,6 +444,34 @@ process::Future<Nothing> CpusetIsolatorProcess::update(
 {
   if(containerResources.find(containerId) == containerResources.end()) {
     containerResources.insert(std::make_pair(containerId, resources));
+    return Nothing();
+  }
+
+  const Option<double> before = containerResources[containerId].cpus();
+  containerResources[containerId] = resources;
+
+  // a recovered container's first update has its
+  // tasks' cpus too; it is only placed again if
+  // its group is short of them or it has none
+  if(recovered.contains(containerId)) {
+    recovered.erase(containerId);
+    assigner->cpus(containerId)
+      .onReady(process::defer(self(), &CpusetIsolatorProcess::recoveredCores,
+                              containerId, lambda::_1));
+    return Nothing();
+  }
+
+  // a running container resized is placed
+  // again, which updates the occupancy index
+  if(pids.contains(containerId) && resources.cpus().isSome() &&
+     (before.isNone() || before.get() != resources.cpus().get())) {
+    assigner->assign(
+      containerId,
+      pids[containerId],
+      resources.cpus().get(),
+      requestedGpus(resources),
+      ioDevices.contains(containerId) ? ioDevices[containerId] : ioDevice,
+      allocatedGpus(containerId));
   }
 
   return Nothing();
@@ -243,14 +508,87 @@ process::Future<Nothing> CpusetIsolatorProcess::_cleanup(
   }
 
   containerResources.erase(containerId);
-  destroy_cpuset_group(containerId.value()).get();
-
-  return Nothing();
+  pids.erase(containerId);
+  recovered.erase(containerId);
+  ioDevices.erase(containerId);
+  return assigner->release(containerId);
 }
 
 Try<mesos::slave::Isolator*> CpusetIsolator::create(
     const mesos::Parameters& parameters)
 {
+  Option<std::string> dbpath;
+  bool topologycache = false;
+  Option<std::string> topologysource;
+  bool calibrate = false;
+  Option<std::string> calibrationseconds;
+  Option<std::string> hotplugpoll;
+  CpusetBackendOptions backendOptions;
+
+  for(const mesos::Parameter& p : parameters.parameter()) {
+    if(p.has_key() && (p.key() == "cpusetdbpath") && p.has_value()) {
+      dbpath = p.value();
+    }
+    else if(p.has_key() && (p.key() == "topologycache") && p.has_value()) {
+      topologycache = (p.value() == "true");
+    }
+    else if(p.has_key() && (p.key() == "topology") && p.has_value()) {
+      topologysource = p.value();
+    }
+    else if(p.has_key() && (p.key() == "calibrate") && p.has_value()) {
+      calibrate = (p.value() == "true");
+    }
+    else if(p.has_key() && (p.key() == "calibrationseconds") && p.has_value()) {
+      calibrationseconds = p.value();
+    }
+    else if(p.has_key() && (p.key() == "hotplugpoll") && p.has_value()) {
+      hotplugpoll = p.value();
+    }
+    else if(p.has_key() && (p.key() == "cgroupversion") && p.has_value()) {
+      backendOptions.version = p.value();
+    }
+    else if(p.has_key() && (p.key() == "cgrouproot") && p.has_value()) {
+      backendOptions.root = p.value();
+    }
+    else if(p.has_key() && (p.key() == "isolatedpartition") && p.has_value()) {
+      backendOptions.isolated = (p.value() == "true");
+    }
+  }
+
+  // the topology reads the root's effective
+  // cpus, the backend has to be chosen first
+  Try<Nothing> backend = select_cpuset_backend(backendOptions);
+  if(backend.isError()) {
+    return Error(backend.error());
+  }
+
+  HwlocTopologyOptions topologyOptions;
+
+  if(topologysource.isSome()) {
+    Try<Nothing> parsed = parse_topology_source(topologysource.get(), topologyOptions);
+    if(parsed.isError()) {
+      return Error(parsed.error());
+    }
+  }
+  if(topologycache) {
+    topologyOptions.cachePath =
+      path::join(dbpath.isSome() ? dbpath.get() : os::getcwd(), "topology.xml");
+  }
+  if(calibrate) {
+    topologyOptions.calibrationPath =
+      path::join(dbpath.isSome() ? dbpath.get() : os::getcwd(), "topology.db");
+  }
+  if(calibrationseconds.isSome()) {
+    topologyOptions.calibrationSeconds = std::stod(calibrationseconds.get());
+  }
+  if(hotplugpoll.isSome()) {
+    topologyOptions.hotplugInterval = std::stod(hotplugpoll.get());
+  }
+
+  // pay for hwloc discovery at module load,
+  // not on the first container launch
+  HwlocTopology::shared(topologyOptions);
+
   return new CpusetIsolator(
      process::Owned<CpusetIsolatorProcess>(new CpusetIsolatorProcess(parameters)), 
      true);
@@ -89,9 +89,36 @@ public:
   process::Future<Nothing> cleanup(
       const mesos::ContainerID& containerId);
 
+protected:
+  virtual void initialize();
+
 private:
   Result<Nothing> updateDb(const int cpusreq);
 
+  // wait for a snapshot newer than 'generation'
+  void watchTopology(const uint64_t generation);
+
+  // re-place containers that lost cores
+  // to cpu hotplug or the root cpuset
+  void topologyChanged(const process::Future<uint64_t>& generation);
+
+  // 'cpus' is what the container's group has now
+  void coresChanged(
+      const mesos::ContainerID& containerId,
+      const Option<CoreMask>& cpus);
+
+  // as coresChanged, a recovered container
+  // with no group is placed
+  void recoveredCores(
+      const mesos::ContainerID& containerId,
+      const Option<CoreMask>& cpus);
+
+  // bus ids of the gpus mesos allocated the
+  // container, none when it has no gpus or
+  // its devices cgroup doesn't name them
+  std::vector<std::string> allocatedGpus(
+      const mesos::ContainerID& containerId);
+
   process::Future<Nothing> _cleanup(
       const mesos::ContainerID& containerId);
 
@@ -100,8 +127,30 @@ private:
   hashmap<mesos::ContainerID, mesos::Resources> containerResources;
   hashmap<mesos::ContainerID, pid_t> pids;
 
+  // recovered, waiting for the
+  // agent's update of their resources
+  hashset<mesos::ContainerID> recovered;
+
+  // executor label 'cpuset.iodevice', or the
+  // 'iodevice' parameter, places the container
+  // near a nic/nvme/accelerator
+  hashmap<mesos::ContainerID, std::string> ioDevices;
+  std::string ioDevice;
+
+  // mesos' devices cgroups, <root>/<container>
+  // names the gpus mesos gave the container
+  std::string gpuDevicesRoot;
+
   double timewindow;
   process::TimeSeries<int> series;
+
+  // 'stochasticepsilon' switches placement to
+  // STOCHASTIC_GREEDY, 'stochasticseed' seeds it
+  SubmodularSchedulerOptions schedulerOptions;
+
+  // one assigner for the life of the isolator,
+  // backed by the shared hwloc topology
+  process::Owned<CpusetAssigner> assigner;
   leveldb::DB* db;
 
 };
@@ -0,0 +1,203 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  core selection off the assigner's actor
+//
+//  the submodular scheduler is the expensive part
+//  of a placement. the assigner hands a copy of the
+//  occupancy's load (and the gpu holders), taken at
+//  one version of the index, to one of a few
+//  CpusetPlacerProcess actors and goes on with the
+//  next container; the placer's choice comes back
+//  and is claimed against the index (see
+//  CoreOccupancy::claim), a choice made on cores
+//  another placement took meanwhile is made again.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCPUSETPLACER__
+#define __MESOSCPUSETPLACER__ 1
+
+#include <stdint.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "CoreOccupancy.hpp"
+#include "CpusetIo.hpp"
+#include "GpuPlacement.hpp"
+#include "HwlocTopology.hpp"
+#include "SubmodularScheduler.hpp"
+#include "TopologyResourceInformation.hpp"
+
+// a container's request with the occupancy
+// it is placed against
+struct PlacementRequest {
+
+  PlacementRequest()
+    : ncpus(0.0), ngpus(0.0), version(0), generation(0) {
+  }
+
+  std::string container;
+  double ncpus;
+  double ngpus;
+  std::string ioDevice;
+
+  // bus ids of the gpus mesos allocated the
+  // container, none when they aren't known
+  std::vector<std::string> allocatedGpus;
+
+  // without the container's own placement
+  CoreLoad load;
+  GpuOccupancy gpus;
+
+  // occupancy version and topology
+  // generation the load was taken at
+  uint64_t version;
+  uint64_t generation;
+};
+
+class CpusetPlacerProcess : public process::Process<CpusetPlacerProcess> {
+
+public:
+  CpusetPlacerProcess(const SubmodularSchedulerOptions& options_)
+    : options(options_) {
+  }
+
+  // none when the topology changed since the
+  // request's load was taken, it no longer
+  // lines up with the snapshot's cores
+  process::Future<Option<CpusetPlacement> > place(const PlacementRequest& request) {
+    if(HwlocTopology::snapshot()->generation != request.generation) {
+      return Option<CpusetPlacement>(None());
+    }
+
+    Try<CpusetPlacement> placement = schedule(options, request);
+    if(placement.isError()) {
+      return process::Failure(placement.error());
+    }
+
+    return Option<CpusetPlacement>(placement.get());
+  }
+
+  // the container's cores (and gpus), reserves
+  // nothing; also run on the assigner's actor
+  // for a placement that keeps losing its claim
+  static Try<CpusetPlacement> schedule(
+    const SubmodularSchedulerOptions& options,
+    const PlacementRequest& request) {
+
+    // the snapshot and its similarity matrix
+    // outlive the schedulers below
+    const std::shared_ptr<const TopologySnapshot> pinned = HwlocTopology::snapshot();
+    const TopologySnapshot& snapshot = *pinned;
+    CoreMask cpuset_to_assign;
+    std::vector<int> gpus;
+
+    // the cores go next to the gpus mesos gave
+    // the container; only when those aren't
+    // known are the gpus chosen here, and then
+    // nothing keeps the container to them
+    if(!request.allocatedGpus.empty() || request.ngpus > 0.0) {
+      if(!request.allocatedGpus.empty()) {
+        gpus = find_gpus(snapshot, request.allocatedGpus);
+        if(gpus.empty()) {
+          LOG(WARNING) << "Container " << request.container
+                       << ": none of its gpus is in the topology";
+        }
+      }
+      else {
+        Try<GpuPlacement> placement = select_gpus(
+          snapshot,
+          request.gpus,
+          static_cast<int>(std::ceil(request.ngpus)),
+          static_cast<int>(std::ceil(request.ncpus)),
+          request.load.cost);
+
+        if(placement.isError()) {
+          return Error(placement.error());
+        }
+
+        gpus = placement.get().gpus;
+      }
+
+      SubmodularScheduler<IoTopologyResourceInformationPolicy> scheduler(
+        options, gpus, request.load);
+      useSimilarity(snapshot, scheduler);
+      scheduler(cpuset_to_assign, request.ncpus);
+    }
+    else if(!request.ioDevice.empty()) {
+      if(snapshot.findIoDevices(request.ioDevice).empty()) {
+        LOG(WARNING) << "No io device matches '" << request.ioDevice << "'";
+      }
+
+      SubmodularScheduler<IoTopologyResourceInformationPolicy> scheduler(
+        options, request.ioDevice, request.load);
+      useSimilarity(snapshot, scheduler);
+      scheduler(cpuset_to_assign, request.ncpus);
+    }
+    else {
+      SubmodularScheduler<CpuTopologyResourceInformationPolicy> scheduler(
+        options, request.load);
+      useSimilarity(snapshot, scheduler);
+      scheduler(cpuset_to_assign, request.ncpus);
+    }
+
+    if(cpuset_to_assign.size() < request.ncpus) {
+      return Error("requested " + stringify(request.ncpus) + " cores, " +
+                   stringify(cpuset_to_assign.size()) + " were placed");
+    }
+
+    // the scheduler picks logical cores, the
+    // cgroup takes os cpu and numa numbers
+    CpusetPlacement placement;
+    placement.cpus = snapshot.getCpusForCores(cpuset_to_assign);
+    placement.mems = snapshot.getNumasForCores(cpuset_to_assign);
+
+    foreach(const int gpu, gpus) {
+      placement.gpus.push_back(snapshot.devices[gpu].busid);
+    }
+
+    return placement;
+  }
+
+private:
+  // the snapshot's matrix, built once per
+  // topology, saves an n^2 pass per placement
+  template< typename Scheduler >
+  static void useSimilarity(const TopologySnapshot& snapshot, Scheduler& scheduler) {
+    if(snapshot.similarity) {
+      scheduler.useSimilarity(*snapshot.similarity);
+    }
+  }
+
+  const SubmodularSchedulerOptions options;
+
+};
+
+#endif
@@ -0,0 +1,145 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <list>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include "CpusetPool.hpp"
+#include "cgroupcpusets.hpp"
+
+// names skipped over when a group of the
+// same name is left from an earlier agent
+static const unsigned MAX_NAME_RETRIES = 1024;
+
+CpusetPool::CpusetPool(const size_t target, const std::string& prefix_)
+  : targetSize(target),
+    prefix(prefix_),
+    next(0) {
+}
+
+// idle groups go with the pool
+CpusetPool::~CpusetPool() {
+  while(!ready.empty()) {
+    ready.front()->destroy();
+    ready.pop_front();
+  }
+}
+
+Option<process::Owned<CpusetGroup> > CpusetPool::claim() {
+  if(ready.empty()) {
+    return None();
+  }
+
+  process::Owned<CpusetGroup> group = ready.front();
+  ready.pop_front();
+  return group;
+}
+
+void CpusetPool::put(const process::Owned<CpusetGroup>& group) {
+  if(full() || !group->isOpen() || cpuset_backend().partitioned()) {
+    Try<Nothing> destroyed = group->destroy();
+    if(destroyed.isError()) {
+      LOG(WARNING) << destroyed.error();
+    }
+    return;
+  }
+
+  ready.push_back(group);
+}
+
+Try<Nothing> CpusetPool::refill() {
+  Try<std::vector<int> > mems = get_cpuset_mems();
+  if(mems.isError()) {
+    return Error(mems.error());
+  }
+
+  CoreMask rootMems;
+  foreach(const int mem, mems.get()) {
+    rootMems.insert(mem);
+  }
+
+  process::Owned<CpusetGroup> group(new CpusetGroup());
+
+  std::string name = prefix + stringify(next++);
+  for(unsigned tries = 0;
+      tries < MAX_NAME_RETRIES && os::exists(path::join(cpuset_backend().root(), name));
+      tries++) {
+    name = prefix + stringify(next++);
+  }
+
+  Try<Nothing> opened = group->open(name, CpusetGroup::EXCLUSIVE);
+  if(opened.isError()) {
+    return opened;
+  }
+
+  // a v1 group takes no tasks without mems
+  Try<Nothing> written = group->writeMems(rootMems);
+  if(written.isError()) {
+    group->destroy();
+    return written;
+  }
+
+  ready.push_back(group);
+  return Nothing();
+}
+
+// a group with tasks is a container's,
+// until its cleanup
+static void remove_if_idle(const std::string& entry) {
+  CpusetGroup group;
+  if(group.open(entry, CpusetGroup::EXISTING).isError()) {
+    return;
+  }
+
+  Try<bool> populated = group.populated();
+  if(populated.isError() || populated.get()) {
+    return;
+  }
+
+  Try<Nothing> destroyed = group.destroy();
+  if(destroyed.isError()) {
+    LOG(WARNING) << destroyed.error();
+  }
+}
+
+static bool is_pool_group(const std::string& entry) {
+  return entry.compare(0, CPUSET_POOL_PREFIX.size(), CPUSET_POOL_PREFIX) == 0;
+}
+
+Try<Nothing> remove_idle_pool_groups() {
+  Try<std::list<std::string> > entries = os::ls(cpuset_backend().root());
+  if(entries.isError()) {
+    return Error(entries.error());
+  }
+
+  foreach(const std::string& entry, entries.get()) {
+    if(is_pool_group(entry)) {
+      remove_if_idle(entry);
+    }
+  }
+
+  return Nothing();
+}
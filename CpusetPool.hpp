@@ -0,0 +1,100 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  cpuset groups made ahead of containers
+//
+//  mkdir on the cpuset hierarchy, and on v1 filling
+//  in a new group's cpuset.mems before it takes
+//  tasks, are the slow part of a launch, and a burst
+//  of launches pays them back to back. the pool
+//  keeps groups created, their mems set to the
+//  root's and their control files open; a launch
+//  claims one, writes its cpus and attaches, and a
+//  cleanup hands the group back instead of removing
+//  it. the owner refills the pool one group at a
+//  time between placements.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCPUSETPOOL__
+#define __MESOSCPUSETPOOL__ 1
+
+#include <deque>
+#include <string>
+
+#include <process/owned.hpp>
+
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include "CpusetGroup.hpp"
+#include "cgroupcpusets.hpp"
+
+class CpusetPool {
+
+public:
+
+  // names start with 'prefix', which itself
+  // starts with CPUSET_POOL_PREFIX
+  explicit CpusetPool(
+    const size_t target = 0,
+    const std::string& prefix = CPUSET_POOL_PREFIX);
+
+  ~CpusetPool();
+
+  size_t target() const {
+    return targetSize;
+  }
+
+  size_t size() const {
+    return ready.size();
+  }
+
+  bool full() const {
+    return ready.size() >= targetSize;
+  }
+
+  // a ready group, none when the pool is dry
+  Option<process::Owned<CpusetGroup> > claim();
+
+  // a group whose container is gone, removed
+  // when the pool is full or it can't be reused
+  void put(const process::Owned<CpusetGroup>& group);
+
+  // create one group
+  Try<Nothing> refill();
+
+private:
+
+  CpusetPool(const CpusetPool&);
+  CpusetPool& operator=(const CpusetPool&);
+
+  const size_t targetSize;
+  const std::string prefix;
+
+  // suffix of the next group's name
+  unsigned next;
+
+  std::deque<process::Owned<CpusetGroup> > ready;
+
+};
+
+// pooled groups an earlier agent left idle,
+// before any pool of this one fills
+Try<Nothing> remove_idle_pool_groups();
+
+#endif
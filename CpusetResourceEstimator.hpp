@@ -201,8 +201,8 @@ public:
 
     const int req_core_est = argmax->first;
 
-    std::set<int> cpuset_to_assign;
-    SubmodularScheduler<CpuTopologyResourceInformationPolicy> scheduler;
+    CoreMask cpuset_to_assign;
+    SubmodularScheduler<CpuTopologyResourceInformationPolicy> scheduler(LAZY_GREEDY);
     scheduler(cpuset_to_assign, req_core_est);
 
     const int est_cpuset_avail = cpuset_to_assign.size();
@@ -14,6 +14,8 @@
 #include <stout/try.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/numify.hpp>
 
 #include "slave/flags.hpp"
 
@@ -29,6 +31,7 @@
 #include <string>
 
 #include "CpusetResourceEstimator.hpp"
+#include "cgroupcpusets.hpp"
 
 struct ParsingError
 {
@@ -43,6 +46,10 @@ template <typename Interface, typename ThresholdActor>
 static Interface* create(mesos::Parameters const& parameters) {
   mesos::Resources resources;
   Option<std::string> dbpath;
+  bool topologycache = false;
+  bool calibrate = false;
+  HwlocTopologyOptions topologyOptions;
+  CpusetBackendOptions backendOptions;
 
   try {
     for (auto const& parameter : parameters.parameter()) {
@@ -60,6 +67,57 @@ static Interface* create(mesos::Parameters const& parameters) {
       if (parameter.key() == "cpusetdbpath") {
         dbpath = parameter.value();
       } 
+
+      if (parameter.key() == "topologycache") {
+        topologycache = (parameter.value() == "true");
+      }
+
+      if (parameter.key() == "calibrate") {
+        calibrate = (parameter.value() == "true");
+      }
+
+      if (parameter.key() == "calibrationseconds") {
+        Try<double> seconds = numify<double>(parameter.value());
+        if (seconds.isError()) {
+          throw ParsingError("calibrationseconds", seconds.error());
+        }
+
+        topologyOptions.calibrationSeconds = seconds.get();
+      }
+
+      if (parameter.key() == "hotplugpoll") {
+        Try<double> seconds = numify<double>(parameter.value());
+        if (seconds.isError()) {
+          throw ParsingError("hotplugpoll", seconds.error());
+        }
+
+        topologyOptions.hotplugInterval = seconds.get();
+      }
+
+      // Parse the cgroup hierarchy holding the cpusets
+      if (parameter.key() == "cgroupversion") {
+        if (parameter.value() != "v1" && parameter.value() != "v2") {
+          throw ParsingError("cgroupversion", "expected v1 or v2");
+        }
+
+        backendOptions.version = parameter.value();
+      }
+
+      if (parameter.key() == "cgrouproot") {
+        backendOptions.root = parameter.value();
+      }
+
+      if (parameter.key() == "isolatedpartition") {
+        backendOptions.isolated = (parameter.value() == "true");
+      }
+
+      // Parse a synthetic or xml topology
+      if (parameter.key() == "topology") {
+        Try<Nothing> parsed = parse_topology_source(parameter.value(), topologyOptions);
+        if (parsed.isError()) {
+          throw ParsingError("topology", parsed.error());
+        }
+      }
     }
   } catch (ParsingError e) {
     LOG(ERROR) << e.message;
@@ -67,6 +125,25 @@ static Interface* create(mesos::Parameters const& parameters) {
   }
 
   const std::string dbpathval = (dbpath.isSome()) ? dbpath.get() : os::getcwd();
+
+  if(topologycache) {
+    topologyOptions.cachePath = path::join(dbpathval, "topology.xml");
+  }
+
+  if(calibrate) {
+    topologyOptions.calibrationPath = path::join(dbpathval, "topology.db");
+  }
+
+  Try<Nothing> backend = select_cpuset_backend(backendOptions);
+  if(backend.isError()) {
+    LOG(ERROR) << backend.error();
+    return nullptr;
+  }
+
+  // pay for hwloc discovery at module load,
+  // not on the first estimate
+  HwlocTopology::shared(topologyOptions);
+
   return new ThresholdActor(resources, dbpathval);
 }
 
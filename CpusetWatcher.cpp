@@ -0,0 +1,174 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <stout/path.hpp>
+
+#include "CpusetWatcher.hpp"
+
+static const uint32_t ROOT_EVENTS = IN_CREATE | IN_DELETE | IN_ONLYDIR;
+static const uint32_t FILE_EVENTS = IN_MODIFY;
+
+CpusetWatcher::CpusetWatcher()
+  : inotifyFd(-1) {
+}
+
+CpusetWatcher::~CpusetWatcher() {
+  if(inotifyFd >= 0) {
+    close(inotifyFd);
+  }
+}
+
+Try<Nothing> CpusetWatcher::start(const std::string& root_) {
+  root = root_;
+
+  inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(inotifyFd < 0) {
+    return ErrnoError("inotify_init1 failed");
+  }
+
+  const int wd = inotify_add_watch(inotifyFd, root.c_str(), ROOT_EVENTS);
+  if(wd < 0) {
+    return ErrnoError("failed to watch " + root);
+  }
+
+  watches[wd].kind = ROOT;
+
+  DIR* dir = opendir(root.c_str());
+  if(dir == NULL) {
+    return ErrnoError("failed to list " + root);
+  }
+
+  for(struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    if(entry->d_type == DT_DIR && entry->d_name[0] != '.') {
+      watchGroup(entry->d_name);
+    }
+  }
+
+  closedir(dir);
+  return Nothing();
+}
+
+void CpusetWatcher::watchGroup(const std::string& group) {
+  const std::string dir = path::join(root, group);
+
+  // removal is reported through the root
+  const int cpus = inotify_add_watch(inotifyFd,
+    path::join(dir, "cpuset.cpus").c_str(), FILE_EVENTS);
+  if(cpus >= 0) {
+    watches[cpus].kind = CPUS;
+    watches[cpus].group = group;
+  }
+
+  const int events = inotify_add_watch(inotifyFd,
+    path::join(dir, "cgroup.events").c_str(), FILE_EVENTS);
+  if(events >= 0) {
+    watches[events].kind = EVENTS;
+    watches[events].group = group;
+  }
+}
+
+// "populated 0" once the last process exits
+bool CpusetWatcher::populated(const std::string& group) const {
+  char buf[256];
+
+  const int fd = open(path::join(root, group, "cgroup.events").c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    return true;
+  }
+
+  const ssize_t n = ::read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+
+  if(n <= 0) {
+    return true;
+  }
+
+  buf[n] = '\0';
+  return std::strstr(buf, "populated 0") == NULL;
+}
+
+std::vector<CpusetEvent> CpusetWatcher::read() {
+  std::vector<CpusetEvent> events;
+
+  char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+  while(true) {
+    const ssize_t len = ::read(inotifyFd, buf, sizeof(buf));
+    if(len < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if(len <= 0) {
+      break;
+    }
+
+    for(char* ptr = buf; ptr < buf + len; ) {
+      const struct inotify_event* event =
+        reinterpret_cast<const struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + event->len;
+
+      std::map<int, Watch>::iterator watch = watches.find(event->wd);
+      if(watch == watches.end()) {
+        continue;
+      }
+
+      // the kernel dropped the watch, its file is gone
+      if(event->mask & IN_IGNORED) {
+        watches.erase(watch);
+        continue;
+      }
+
+      const Watch w = watch->second;
+
+      switch(w.kind) {
+        case ROOT:
+          if(event->len > 0 && (event->mask & IN_ISDIR) && event->name[0] != '.') {
+            if(event->mask & IN_CREATE) {
+              watchGroup(event->name);
+              events.push_back(CpusetEvent(CpusetEvent::CREATED, event->name));
+            }
+            else if(event->mask & IN_DELETE) {
+              events.push_back(CpusetEvent(CpusetEvent::REMOVED, event->name));
+            }
+          }
+          break;
+
+        case CPUS:
+          events.push_back(CpusetEvent(CpusetEvent::CPUS_CHANGED, w.group));
+          break;
+
+        case EVENTS:
+          if(!populated(w.group)) {
+            events.push_back(CpusetEvent(CpusetEvent::EMPTIED, w.group));
+          }
+          break;
+      }
+    }
+  }
+
+  return events;
+}
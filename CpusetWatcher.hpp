@@ -0,0 +1,107 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  inotify on the cpuset hierarchy
+//
+//  watches the groups directly under the cpuset root:
+//  groups created and removed, writes to a group's
+//  cpuset.cpus, and cgroup.events where the kernel has
+//  it (the unified hierarchy), which changes when the
+//  last process of a group exits. cgroup v1 has no
+//  such file and doesn't notify on tasks, there an
+//  exited container is seen when its group is removed.
+//
+//  fd() is non-blocking, the owner polls it and calls
+//  read() when it is readable.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSCPUSETWATCHER__
+#define __MESOSCPUSETWATCHER__ 1
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+struct CpusetEvent {
+
+  enum Kind {
+    CREATED,
+    REMOVED,
+    CPUS_CHANGED,
+
+    // no processes left in the group
+    EMPTIED
+  };
+
+  CpusetEvent(const Kind kind_, const std::string& group_)
+    : kind(kind_), group(group_) {
+  }
+
+  Kind kind;
+  std::string group;
+};
+
+class CpusetWatcher {
+
+public:
+
+  CpusetWatcher();
+
+  ~CpusetWatcher();
+
+  // watch root and the groups already in it
+  Try<Nothing> start(const std::string& root);
+
+  int fd() const {
+    return inotifyFd;
+  }
+
+  // the events pending on fd()
+  std::vector<CpusetEvent> read();
+
+private:
+
+  CpusetWatcher(const CpusetWatcher&);
+  CpusetWatcher& operator=(const CpusetWatcher&);
+
+  void watchGroup(const std::string& group);
+
+  bool populated(const std::string& group) const;
+
+  enum WatchKind {
+    ROOT,
+    CPUS,
+    EVENTS
+  };
+
+  struct Watch {
+    WatchKind kind;
+    std::string group;
+  };
+
+  int inotifyFd;
+  std::string root;
+
+  std::map<int, Watch> watches;
+
+};
+
+#endif
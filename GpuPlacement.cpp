@@ -0,0 +1,352 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <sstream>
+
+#include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include "GpuPlacement.hpp"
+
+// subsets scored exhaustively, above this
+// the subsets are grown greedily instead
+static const double MAX_GPU_SUBSETS = 4096;
+
+void GpuOccupancy::hold(
+  const std::string& busid,
+  const std::string& container) {
+  gpuHolders[busid].insert(container);
+}
+
+void GpuOccupancy::release(const std::string& container) {
+  for(std::map<std::string, std::set<std::string> >::iterator gpu = gpuHolders.begin();
+      gpu != gpuHolders.end(); ++gpu) {
+    gpu->second.erase(container);
+  }
+}
+
+int GpuOccupancy::holders(const std::string& busid) const {
+  std::map<std::string, std::set<std::string> >::const_iterator gpu =
+    gpuHolders.find(busid);
+  return (gpu != gpuHolders.end()) ? static_cast<int>(gpu->second.size()) : 0;
+}
+
+std::vector<std::string> GpuOccupancy::held(const std::string& container) const {
+  std::vector<std::string> busids;
+
+  for(std::map<std::string, std::set<std::string> >::const_iterator gpu = gpuHolders.begin();
+      gpu != gpuHolders.end(); ++gpu) {
+    if(gpu->second.count(container)) {
+      busids.push_back(gpu->first);
+    }
+  }
+
+  return busids;
+}
+
+float gpu_distance(
+  const TopologySnapshot& snapshot,
+  const int a,
+  const int b) {
+  const IoDevice& da = snapshot.devices[a];
+  const IoDevice& db = snapshot.devices[b];
+
+  // hops up to the closest common bridge and down
+  size_t common = 0;
+  while(common < da.pciPath.size() && common < db.pciPath.size() &&
+        da.pciPath[common] == db.pciPath[common]) {
+    common++;
+  }
+
+  float d = static_cast<float>((da.pciPath.size() - common) +
+                               (db.pciPath.size() - common));
+
+  if(!da.cores.empty() && !db.cores.empty() && da.cores != db.cores) {
+    d += snapshot.getRelativeCoreDistance(da.cores.first(), db.cores.first());
+  }
+
+  return d;
+}
+
+static float score_gpus(
+  const TopologySnapshot& snapshot,
+  const std::vector<int>& gpus,
+  const int ncores,
+  const std::valarray<float>& cost,
+  CoreMask& local) {
+  float score = 0.0;
+
+  for(size_t a = 0; a < gpus.size(); a++) {
+    for(size_t b = a + 1; b < gpus.size(); b++) {
+      score += gpu_distance(snapshot, gpus[a], gpus[b]);
+    }
+  }
+
+  local.clear();
+  foreach(const int gpu, gpus) {
+    local |= snapshot.devices[gpu].cores;
+  }
+
+  local &= snapshot.onlineCores;
+
+  // the least loaded local cores
+  std::vector<float> load;
+  foreach(const int core, local) {
+    if(core < static_cast<int>(cost.size()) && std::isfinite(cost[core])) {
+      load.push_back(cost[core]);
+    }
+  }
+
+  std::sort(load.begin(), load.end());
+
+  const int fit = std::min(ncores, static_cast<int>(load.size()));
+  for(int c = 0; c < fit; c++) {
+    score += load[c];
+  }
+
+  // the rest land on the nearest remote cores
+  if(fit < ncores && !local.empty()) {
+    const int near = local.first();
+    float remote = std::numeric_limits<float>::infinity();
+
+    foreach(const int core, snapshot.onlineCores) {
+      if(!local.count(core) &&
+         core < static_cast<int>(cost.size()) && std::isfinite(cost[core])) {
+        remote = std::min(remote, snapshot.getRelativeCoreDistance(near, core));
+      }
+    }
+
+    if(std::isfinite(remote)) {
+      score += (ncores - fit) * remote;
+    }
+  }
+
+  return score;
+}
+
+static void keep_best(
+  const TopologySnapshot& snapshot,
+  const std::vector<int>& gpus,
+  const int ncores,
+  const std::valarray<float>& cost,
+  GpuPlacement& best,
+  bool& found) {
+  CoreMask local;
+  const float score = score_gpus(snapshot, gpus, ncores, cost, local);
+
+  if(!found || score < best.score) {
+    best.gpus = gpus;
+    best.local = local;
+    best.score = score;
+    found = true;
+  }
+}
+
+static void enumerate_gpus(
+  const TopologySnapshot& snapshot,
+  const std::vector<int>& free,
+  const size_t start,
+  const int ngpus,
+  const int ncores,
+  const std::valarray<float>& cost,
+  std::vector<int>& chosen,
+  GpuPlacement& best,
+  bool& found) {
+  if(static_cast<int>(chosen.size()) == ngpus) {
+    keep_best(snapshot, chosen, ncores, cost, best, found);
+    return;
+  }
+
+  for(size_t g = start; g < free.size(); g++) {
+    chosen.push_back(free[g]);
+    enumerate_gpus(snapshot, free, g + 1, ngpus, ncores, cost, chosen, best, found);
+    chosen.pop_back();
+  }
+}
+
+Try<GpuPlacement> select_gpus(
+  const TopologySnapshot& snapshot,
+  const GpuOccupancy& occupancy,
+  const int ngpus,
+  const int ncores,
+  const std::valarray<float>& cost,
+  const int maxHolders) {
+  std::vector<int> free;
+
+  for(size_t d = 0; d < snapshot.devices.size(); d++) {
+    const IoDevice& device = snapshot.devices[d];
+    if(device.kind == IO_GPU && occupancy.holders(device.busid) < maxHolders) {
+      free.push_back(d);
+    }
+  }
+
+  if(ngpus <= 0 || ngpus > static_cast<int>(free.size())) {
+    return Error("requested " + stringify(ngpus) + " gpus, " +
+                 stringify(free.size()) + " are free");
+  }
+
+  GpuPlacement best;
+  bool found = false;
+
+  double subsets = 1.0;
+  for(int k = 0; k < ngpus; k++) {
+    subsets = subsets * (free.size() - k) / (k + 1);
+  }
+
+  if(subsets <= MAX_GPU_SUBSETS) {
+    std::vector<int> chosen;
+    enumerate_gpus(snapshot, free, 0, ngpus, ncores, cost, chosen, best, found);
+    return best;
+  }
+
+  // grow a set from every gpu, adding the gpu
+  // closest to those already in it
+  foreach(const int seed, free) {
+    std::vector<int> chosen(1, seed);
+
+    while(static_cast<int>(chosen.size()) < ngpus) {
+      int next = -1;
+      float nextDistance = std::numeric_limits<float>::infinity();
+
+      foreach(const int gpu, free) {
+        if(std::find(chosen.begin(), chosen.end(), gpu) != chosen.end()) {
+          continue;
+        }
+
+        float d = 0.0;
+        foreach(const int in, chosen) {
+          d += gpu_distance(snapshot, in, gpu);
+        }
+
+        if(d < nextDistance) {
+          next = gpu;
+          nextDistance = d;
+        }
+      }
+
+      chosen.push_back(next);
+    }
+
+    keep_best(snapshot, chosen, ncores, cost, best, found);
+  }
+
+  return best;
+}
+
+// /dev/nvidia<minor> is char 195:<minor>,
+// 195:255 is nvidiactl
+static const int NVIDIA_MAJOR = 195;
+static const int NVIDIA_CTL_MINOR = 255;
+
+// the 'Device Minor:' of each gpu the driver lists
+static std::map<int, std::string> nvidia_minors(const std::string& driverRoot) {
+  std::map<int, std::string> minors;
+
+  Try<std::list<std::string> > busids = os::ls(driverRoot);
+  if(busids.isError()) {
+    return minors;
+  }
+
+  foreach(const std::string& busid, busids.get()) {
+    std::ifstream information(path::join(driverRoot, busid, "information"));
+    std::string line;
+
+    while(std::getline(information, line)) {
+      if(line.compare(0, 13, "Device Minor:") == 0) {
+        minors[std::atoi(line.c_str() + 13)] = busid;
+        break;
+      }
+    }
+  }
+
+  return minors;
+}
+
+Try<std::vector<std::string> > read_allocated_gpus(
+  const std::string& devicesGroup,
+  const std::string& driverRoot) {
+  const std::string list = path::join(devicesGroup, "devices.list");
+
+  std::ifstream listfile(list);
+  if(!listfile.is_open()) {
+    return Error("error opening " + list);
+  }
+
+  std::vector<int> allowed;
+  std::string line;
+
+  // "c 195:0 rwm"; "a *:* rwm" lets the
+  // container open any device
+  while(std::getline(listfile, line)) {
+    std::istringstream entry(line);
+    std::string type, numbers;
+    entry >> type >> numbers;
+
+    if(type == "a") {
+      return std::vector<std::string>();
+    }
+
+    int major = -1, minor = -1;
+    if(type == "c" && std::sscanf(numbers.c_str(), "%d:%d", &major, &minor) == 2 &&
+       major == NVIDIA_MAJOR && minor >= 0 && minor != NVIDIA_CTL_MINOR) {
+      allowed.push_back(minor);
+    }
+  }
+
+  std::vector<std::string> busids;
+  if(allowed.empty()) {
+    return busids;
+  }
+
+  const std::map<int, std::string> minors = nvidia_minors(driverRoot);
+  foreach(const int minor, allowed) {
+    std::map<int, std::string>::const_iterator busid = minors.find(minor);
+    if(busid != minors.end()) {
+      busids.push_back(busid->second);
+    }
+  }
+
+  return busids;
+}
+
+std::vector<int> find_gpus(
+  const TopologySnapshot& snapshot,
+  const std::vector<std::string>& busids) {
+  std::vector<int> gpus;
+
+  foreach(const std::string& busid, busids) {
+    for(size_t d = 0; d < snapshot.devices.size(); d++) {
+      if(snapshot.devices[d].kind == IO_GPU && snapshot.devices[d].busid == busid) {
+        gpus.push_back(d);
+        break;
+      }
+    }
+  }
+
+  return gpus;
+}
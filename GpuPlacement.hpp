@@ -0,0 +1,126 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  joint gpu + core selection
+//
+//  a multi gpu container wants its gpus close to each
+//  other (one pcie switch, one numa node) and its cores
+//  close to its gpus. the gpus are chosen first, by
+//  scoring every subset of the free gpus (a greedy
+//  grow from each gpu when there are too many subsets)
+//  on
+//
+//    pcie hops + numa distance between the gpus
+//    cores that don't fit next to the gpus, times
+//      the distance to the nearest remote core
+//    tasks already running on the cores that do
+//
+//  the cores are then placed by the submodular
+//  scheduler with the chosen gpus' local cores as
+//  its first domains. works off the snapshot alone,
+//  an xml topology with gpu pci devices is enough.
+//
+//  mesos' gpu isolator decides which gpus a container
+//  gets; when its devices cgroup names them the cores
+//  are placed next to those and the selection above
+//  is not used.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSGPUPLACEMENT__
+#define __MESOSGPUPLACEMENT__ 1
+
+#include <map>
+#include <set>
+#include <string>
+#include <valarray>
+#include <vector>
+
+#include <stout/try.hpp>
+
+#include "TopologySnapshot.hpp"
+
+// containers holding each gpu, keyed by pci
+// bus id so it survives a topology rebuild
+class GpuOccupancy {
+
+public:
+
+  void hold(const std::string& busid, const std::string& container);
+
+  // drop every gpu the container holds
+  void release(const std::string& container);
+
+  int holders(const std::string& busid) const;
+
+  std::vector<std::string> held(const std::string& container) const;
+
+private:
+
+  std::map<std::string, std::set<std::string> > gpuHolders;
+
+};
+
+struct GpuPlacement {
+
+  GpuPlacement() : score(0.0) {
+  }
+
+  // indices into the snapshot's devices
+  std::vector<int> gpus;
+
+  // cores local to the chosen gpus
+  CoreMask local;
+
+  float score;
+};
+
+// pcie hops between two devices plus the relative
+// distance between their local cores
+float gpu_distance(
+  const TopologySnapshot& snapshot,
+  const int a,
+  const int b);
+
+// pick 'ngpus' gpus with fewer than 'maxHolders'
+// containers each for a container that also wants
+// 'ncores' cores. 'cost' is the task count per core,
+// +inf for cores outside the agent's cpuset.
+Try<GpuPlacement> select_gpus(
+  const TopologySnapshot& snapshot,
+  const GpuOccupancy& occupancy,
+  const int ngpus,
+  const int ncores,
+  const std::valarray<float>& cost,
+  const int maxHolders = 1);
+
+// pci bus ids of the nvidia gpus a container's
+// devices cgroup (v1 devices.list under
+// 'devicesGroup') lets it open, the gpus mesos'
+// gpu isolator allocated it. none when the
+// group allows every device or has no gpu
+Try<std::vector<std::string> > read_allocated_gpus(
+  const std::string& devicesGroup,
+  const std::string& driverRoot = "/proc/driver/nvidia/gpus");
+
+// indices into the snapshot's devices of the
+// gpus with these bus ids, unknown ones left out
+std::vector<int> find_gpus(
+  const TopologySnapshot& snapshot,
+  const std::vector<std::string>& busids);
+
+#endif
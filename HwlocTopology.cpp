@@ -21,10 +21,24 @@
 #include <utility>
 #include <algorithm>
 #include <limits>
+#include <list>
+#include <map>
+#include <cstdio>
+#include <cmath>
 
 #include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/strings.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/duration.hpp>
+
+#include <glog/logging.h>
 
 #include "HwlocTopology.hpp"
+#include "LatencyCalibration.hpp"
+#include "CpuList.hpp"
+#include "cgroupcpusets.hpp"
 
 
 #ifdef USE_CUDA
@@ -42,30 +56,440 @@ Try<bool> FALSE_ON_FAIL(CUresult& res)
 #endif
 
 
+HwlocTopology& HwlocTopology::shared(
+  const HwlocTopologyOptions& options) {
+  // never destroyed, the actor lives as
+  // long as the agent that loaded us
+  static HwlocTopology* topology = new HwlocTopology(options);
+  return *topology;
+}
+
 process::Future<float> HwlocTopologyProcess::getCoreDistance(
   const int i, 
   const int j) {
-  const int ncores = nCores().get();
-  return coreDistmat[i*ncores+j].latency[i*ncores+j];
+  return topology_snapshot()->getCoreDistance(i, j);
 }
 
 process::Future<int> HwlocTopologyProcess::getNumaForCore(
   const int core_os_id ) {
+  return topology_snapshot()->getNumaForCore(core_os_id);
+}
+
+static CoreMask bitmap_to_mask(hwloc_const_bitmap_t bitmap) {
+  CoreMask mask;
+  unsigned cpu;
+
+  hwloc_bitmap_foreach_begin(cpu, bitmap)
+    if(cpu < CoreMask::CAPACITY) {
+      mask.insert(cpu);
+    }
+  hwloc_bitmap_foreach_end();
+
+  return mask;
+}
+
+// the cpus this agent may place on, the online
+// cpus limited to the root cpuset's effective cpus.
+// the isolator's own isolated partitions took
+// their cpus out of those, they are added back
+//
+static Option<CoreMask> available_cpus() {
+  Try<CoreMask> online = read_cpulist("/sys/devices/system/cpu/online");
+  if(online.isError()) {
+    return None();
+  }
+
+  const CpusetBackend& backend = cpuset_backend();
+  Try<CoreMask> effective = read_cpulist(
+    path::join(backend.root(), backend.effectiveCpusFile()).c_str());
+
+  if(effective.isError()) {
+    return online.get();
+  }
+
+  return online.get() & (effective.get() | get_cpuset_partition_cpus());
+}
+
+static inline int ancestor_index(
+  hwloc_topology_t topology,
+  hwloc_obj_t obj,
+  const hwloc_obj_type_t T)
+{
+  hwloc_obj_t ancestor = hwloc_get_ancestor_obj_by_type(topology, T, obj);
+  return (ancestor != NULL) ? static_cast<int>(ancestor->logical_index) : -1;
+}
+
+static inline int cache_index(
+  hwloc_obj_t obj,
+  const unsigned depth)
+{
+  for(hwloc_obj_t cur = obj->parent; cur != NULL; cur = cur->parent) {
+    if(cur->type == HWLOC_OBJ_CACHE && cur->attr->cache.depth == depth) {
+      return static_cast<int>(cur->logical_index);
+    }
+  }
 
-  int retval = -1;
+  return -1;
+}
 
-  if(coresPerNuma.count(core_os_id)) {
+// innermost group (die, ccd, snc cluster)
+// holding the object, -1 if there is none
+static inline int group_index(hwloc_obj_t obj)
+{
+  for(hwloc_obj_t cur = obj->parent; cur != NULL; cur = cur->parent) {
+    if(cur->type == HWLOC_OBJ_GROUP) {
+      return static_cast<int>(cur->logical_index);
+    }
+  }
 
-    std::for_each(std::begin(coresPerNuma), std::end(coresPerNuma),
-      [&retval, &core_os_id] (std::pair<unsigned, std::vector<unsigned> > numas) {
-        if(static_cast<int>(numas.first) == core_os_id && numas.second.size() > 0) {
-          retval = static_cast<int>(numas.second[0]);
+  return -1;
+}
+
+void HwlocTopologyProcess::publishSnapshot() {
+  TopologySnapshot* snapshot = new TopologySnapshot();
+
+  const int ncores = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_CORE);
+  const int npus = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_PU);
+
+  snapshot->nsockets = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_SOCKET);
+  snapshot->nnumas = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NODE);
+  snapshot->ncores = ncores;
+  snapshot->npus = npus;
+
+  for(int i = 0; i < ncores; i++) {
+    hwloc_obj_t core = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, i);
+    hwloc_obj_t numa = hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_NODE, core);
+
+    snapshot->coreOsIndex.push_back(core->os_index);
+    snapshot->coreSocket.push_back(ancestor_index(topology, core, HWLOC_OBJ_SOCKET));
+
+    // cpuset.mems takes os indices
+    snapshot->coreNuma.push_back((numa != NULL) ? static_cast<int>(numa->os_index) : 0);
+
+    snapshot->coreL2.push_back(cache_index(core, 2));
+    snapshot->coreL3.push_back(cache_index(core, 3));
+
+    // amd ccd/ccx and other dies show up as groups
+    snapshot->coreGroup.push_back(group_index(core));
+    snapshot->pusPerCore.push_back(
+      hwloc_get_nbobjs_inside_cpuset_by_type(topology, core->cpuset, HWLOC_OBJ_PU));
+  }
+
+  hwloc_const_cpuset_t online = hwloc_topology_get_online_cpuset(topology);
+  const Option<CoreMask> available = liveTopology ? available_cpus() : None();
+
+  for(int p = 0; p < npus; p++) {
+    hwloc_obj_t pu = hwloc_get_obj_by_type(topology, HWLOC_OBJ_PU, p);
+    snapshot->puOsIndex.push_back(pu->os_index);
+    snapshot->puCore.push_back(ancestor_index(topology, pu, HWLOC_OBJ_CORE));
+
+    if(hwloc_bitmap_isset(online, pu->os_index) &&
+       (available.isNone() || available.get().count(pu->os_index)) &&
+       !snapshot->onlineCpus.insert(pu->os_index)) {
+      LOG(WARNING) << "Cpu " << pu->os_index << " is past the "
+                   << CoreMask::CAPACITY << " cpus a CoreMask holds, not placing on it";
+    }
+  }
+
+  snapshot->buildIndex();
+
+  snapshot->buildDomains();
+
+  discoverIoDevices(*snapshot);
+
+  snapshot->distance.resize(ncores * ncores, 0.0);
+
+  if(coreDistmat != NULL && static_cast<int>(coreDistmat->nbobjs) == ncores) {
+    std::copy(coreDistmat->latency, coreDistmat->latency + (ncores * ncores),
+      std::begin(snapshot->distance));
+  }
+  else {
+    deriveCoreDistances(*snapshot);
+  }
+
+  // measured latencies replace the estimate,
+  // similarity is taken relative to the
+  // closest pair of distinct cores
+  if(options.calibrationPath.isSome() && liveTopology && ncores > 1) {
+    Try<std::vector<float> > latency = calibrate_core_latency(
+      *snapshot, options.calibrationPath.get(), options.calibrationSeconds);
+
+    if(latency.isError()) {
+      LOG(WARNING) << "Core latency calibration failed: " << latency.error();
+    }
+    else {
+      snapshot->distance = latency.get();
+      snapshot->distanceUnit = std::numeric_limits<float>::infinity();
+
+      for(int i = 0; i < ncores; i++) {
+        for(int j = 0; j < ncores; j++) {
+          if(i != j && snapshot->distance[i * ncores + j] > 0.0) {
+            snapshot->distanceUnit =
+              std::min(snapshot->distanceUnit, snapshot->distance[i * ncores + j]);
+          }
         }
-    });
+      }
+
+      if(!std::isfinite(snapshot->distanceUnit)) {
+        snapshot->distanceUnit = 1.0;
+      }
+    }
+  }
+  else if(options.calibrationPath.isSome() && !liveTopology) {
+    LOG(WARNING) << "Not calibrating core latencies of an xml/synthetic topology";
+  }
+
+  snapshot->buildSimilarity();
+
+  publish_topology_snapshot(snapshot);
+}
+
+static IoDeviceKind pci_kind(const unsigned classId) {
+  switch(classId >> 8) {
+    case 0x01: return IO_STORAGE;
+    case 0x02: return IO_NIC;
+    case 0x03: return IO_GPU;
+    case 0x12: return IO_ACCELERATOR;
+    default: break;
+  }
+
+  // co-processors
+  return (classId == 0x0b40) ? IO_ACCELERATOR : IO_OTHER;
+}
+
+static IoDeviceKind osdev_kind(const hwloc_obj_osdev_type_t type) {
+  switch(type) {
+    case HWLOC_OBJ_OSDEV_BLOCK: return IO_STORAGE;
+    case HWLOC_OBJ_OSDEV_NETWORK:
+    case HWLOC_OBJ_OSDEV_OPENFABRICS: return IO_NIC;
+    case HWLOC_OBJ_OSDEV_GPU: return IO_GPU;
+    case HWLOC_OBJ_OSDEV_COPROC: return IO_ACCELERATOR;
+    default: break;
+  }
+
+  return IO_OTHER;
+}
+
+// one entry per pci device, named after the os
+// devices (eth0, mlx5_0, nvme0n1) below it, and os
+// devices hwloc found outside of the pci tree. the
+// local cores are those of the first non-io
+// ancestor, the package or numa node the device
+// hangs off.
+//
+void HwlocTopologyProcess::discoverIoDevices(TopologySnapshot& snapshot) {
+  std::map<hwloc_obj_t, int> pcidevs;
+
+  for(hwloc_obj_t pci = hwloc_get_next_pcidev(topology, NULL);
+      pci != NULL; pci = hwloc_get_next_pcidev(topology, pci)) {
+    IoDevice device;
+    char busid[16];
+
+    snprintf(busid, sizeof(busid), "%04x:%02x:%02x.%01x",
+      pci->attr->pcidev.domain,
+      pci->attr->pcidev.bus,
+      pci->attr->pcidev.dev,
+      pci->attr->pcidev.func);
+
+    device.busid = busid;
+    device.vendor = pci->attr->pcidev.vendor_id;
+    device.device = pci->attr->pcidev.device_id;
+    device.classId = pci->attr->pcidev.class_id;
+    device.kind = pci_kind(device.classId);
+
+    for(hwloc_obj_t bridge = pci->parent;
+        bridge != NULL && bridge->type == HWLOC_OBJ_BRIDGE;
+        bridge = bridge->parent) {
+      device.pciPath.insert(device.pciPath.begin(),
+        static_cast<int>(bridge->logical_index));
+    }
+
+    pcidevs[pci] = snapshot.devices.size();
+    snapshot.devices.push_back(device);
+  }
+
+  for(hwloc_obj_t osdev = hwloc_get_next_osdev(topology, NULL);
+      osdev != NULL; osdev = hwloc_get_next_osdev(topology, osdev)) {
+    if(osdev->name == NULL) {
+      continue;
+    }
+
+    std::map<hwloc_obj_t, int>::const_iterator pci = pcidevs.find(osdev->parent);
+
+    if(pci != pcidevs.end()) {
+      IoDevice& device = snapshot.devices[pci->second];
+      device.names.push_back(osdev->name);
+
+      // a gpu's display class says nothing about
+      // an infiniband port on the same function
+      if(device.kind == IO_OTHER) {
+        device.kind = osdev_kind(osdev->attr->osdev.type);
+      }
+
+      continue;
+    }
+
+    IoDevice device;
+    device.kind = osdev_kind(osdev->attr->osdev.type);
+    device.names.push_back(osdev->name);
+
+    pcidevs[osdev] = snapshot.devices.size();
+    snapshot.devices.push_back(device);
+  }
+
+  for(std::map<hwloc_obj_t, int>::const_iterator dev = pcidevs.begin();
+      dev != pcidevs.end(); ++dev) {
+    IoDevice& device = snapshot.devices[dev->second];
+    hwloc_obj_t local = hwloc_get_non_io_ancestor_obj(topology, dev->first);
+
+    if(local == NULL || local->cpuset == NULL) {
+      continue;
+    }
+
+    device.cores = snapshot.getCoresForCpus(bitmap_to_mask(local->cpuset));
+
+    hwloc_obj_t numa = (local->type == HWLOC_OBJ_NODE) ? local :
+      hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_NODE, local);
+
+    // a device below the package of a single node
+    if(numa == NULL && local->nodeset != NULL &&
+       hwloc_bitmap_weight(local->nodeset) == 1) {
+      for(hwloc_obj_t node = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_NODE, NULL);
+          node != NULL && numa == NULL;
+          node = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_NODE, node)) {
+        if(static_cast<int>(node->os_index) == hwloc_bitmap_first(local->nodeset)) {
+          numa = node;
+        }
+      }
+    }
+
+    device.numa = (numa != NULL) ? static_cast<int>(numa->os_index) : -1;
+  }
+}
+
+// relative distance of the closest level of the
+// hierarchy two cores share, before numa weighting
+//
+static const float SAME_L2_DISTANCE = 1.0;
+static const float SAME_L3_DISTANCE = 2.0;
+static const float SAME_NUMA_DISTANCE = 4.0;
+static const float SAME_SOCKET_DISTANCE = 6.0;
+static const float CROSS_SOCKET_DISTANCE = 8.0;
+
+// acpi slit distance of a local access
+static const float SLIT_LOCAL = 10.0;
+
+// read the kernel's numa distance table, keyed
+// by numa os index, from
+// /sys/devices/system/node/node<N>/distance
+//
+static std::map<std::pair<int, int>, float> read_slit() {
+  std::map<std::pair<int, int>, float> slit;
+  const std::string nodes_path = "/sys/devices/system/node";
+
+  Try<std::list<std::string> > entries = os::ls(nodes_path);
+  if(entries.isError()) {
+    return slit;
+  }
+
+  // rows list distances to every online node
+  // in ascending node id order
+  std::vector<int> nodes;
+  foreach(const std::string& entry, entries.get()) {
+    int node;
+    if(sscanf(entry.c_str(), "node%d", &node) == 1) {
+      nodes.push_back(node);
+    }
+  }
+
+  std::sort(std::begin(nodes), std::end(nodes));
+
+  foreach(const int node, nodes) {
+    Try<std::string> row =
+      os::read(path::join(nodes_path, "node" + stringify(node), "distance"));
+    if(row.isError()) {
+      continue;
+    }
+
+    const std::vector<std::string> tokens = strings::tokenize(row.get(), " \n");
+    for(size_t k = 0; k < tokens.size() && k < nodes.size(); k++) {
+      slit[std::make_pair(node, nodes[k])] = std::stof(tokens[k]);
+    }
+  }
+
+  return slit;
+}
+
+void HwlocTopologyProcess::deriveCoreDistances(TopologySnapshot& snapshot) {
+  const int ncores = snapshot.ncores;
+
+  // numa distances, the kernel's slit for the live
+  // machine, hwloc's for xml/synthetic topologies
+  std::map<std::pair<int, int>, float> slit;
+
+  if(liveTopology) {
+    slit = read_slit();
+  }
+  else {
+    const struct hwloc_distances_s* numaDistmat =
+      hwloc_get_whole_distance_matrix_by_type(topology, HWLOC_OBJ_NODE);
+
+    if(numaDistmat != NULL) {
+      const unsigned n = numaDistmat->nbobjs;
+      for(unsigned a = 0; a < n; a++) {
+        for(unsigned b = 0; b < n; b++) {
+          hwloc_obj_t na = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NODE, a);
+          hwloc_obj_t nb = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NODE, b);
+          if(na == NULL || nb == NULL) {
+            continue;
+          }
 
+          slit[std::make_pair(na->os_index, nb->os_index)] =
+            SLIT_LOCAL * numaDistmat->latency[a * n + b] /
+                         numaDistmat->latency[a * n + a];
+        }
+      }
+    }
   }
 
-  return retval;
+  for(int i = 0; i < ncores; i++) {
+    for(int j = 0; j < ncores; j++) {
+      float d = 0.0;
+
+      if(i == j) {
+        d = 0.0;
+      }
+      else if(snapshot.coreL2[i] >= 0 && snapshot.coreL2[i] == snapshot.coreL2[j]) {
+        d = SAME_L2_DISTANCE;
+      }
+      else if(snapshot.coreL3[i] >= 0 && snapshot.coreL3[i] == snapshot.coreL3[j]) {
+        d = SAME_L3_DISTANCE;
+      }
+      else if(snapshot.coreNuma[i] == snapshot.coreNuma[j]) {
+        d = SAME_NUMA_DISTANCE;
+      }
+      else if(snapshot.coreSocket[i] == snapshot.coreSocket[j]) {
+        d = SAME_SOCKET_DISTANCE;
+      }
+      else {
+        d = CROSS_SOCKET_DISTANCE;
+      }
+
+      // remote numa accesses cost slit/10 times a local one
+      std::map<std::pair<int, int>, float>::const_iterator numa =
+        slit.find(std::make_pair(snapshot.coreNuma[i], snapshot.coreNuma[j]));
+
+      if(numa != slit.end()) {
+        d *= numa->second / SLIT_LOCAL;
+      }
+      else if(snapshot.coreNuma[i] != snapshot.coreNuma[j]) {
+        // no table, assume the common remote slit of 20
+        d *= 2.0;
+      }
+
+      snapshot.distance[i * ncores + j] = d;
+    }
+  }
 }
 
 struct sortpred {
@@ -82,169 +506,273 @@ inline int map_acc(
   return lhs + rhs.second;
 }
 
-HwlocTopologyProcess::HwlocTopologyProcess() {
-  if (hwloc_topology_init(&(topology))) {
-    /* error in initialize hwloc library */
-    error(-1, 1, "%s: hwloc_loc.topo_init() failed", __func__);
+Try<Nothing> parse_topology_source(
+  const std::string& source,
+  HwlocTopologyOptions& options) {
+  if(strings::startsWith(source, "xml:")) {
+    options.xmlPath = source.substr(4);
+    return Nothing();
   }
 
-  const unsigned long topo_flags = HWLOC_TOPOLOGY_FLAG_WHOLE_SYSTEM |
-                                   HWLOC_TOPOLOGY_FLAG_IO_DEVICES |
-                                   HWLOC_TOPOLOGY_FLAG_IO_BRIDGES;
+  if(strings::startsWith(source, "synthetic:")) {
+    const std::string synthetic = source.substr(10);
 
-  hwloc_topology_set_flags(topology, topo_flags);
-  hwloc_topology_load(topology);
+    if(!os::exists(synthetic)) {
+      options.synthetic = synthetic;
+      return Nothing();
+    }
 
-  root = hwloc_get_root_obj(topology);
+    Try<std::string> description = os::read(synthetic);
+    if(description.isError()) {
+      return Error("failed to read " + synthetic + ": " + description.error());
+    }
 
-  discoverCpuTopology(topology, root, NULL);
-  coreDistmat = hwloc_get_whole_distance_matrix_by_type(topology,
-                                                      HWLOC_OBJ_CORE);
+    options.synthetic = strings::trim(description.get());
+    return Nothing();
+  }
 
-  discoverGpuTopology(topology, root, NULL);
+  return Error("unknown topology source '" + source + "'");
 }
 
-process::Future<int> HwlocTopologyProcess::nSockets() {
-  return coresPerSocket.size();
-}
+Try<Nothing> HwlocTopologyProcess::loadTopology(
+  const Option<std::string>& xmlPath,
+  const Option<std::string>& synthetic,
+  const bool thisSystem) {
+  if (hwloc_topology_init(&(topology))) {
+    /* error in initialize hwloc library */
+    return Error("hwloc topology init failed");
+  }
 
-process::Future<int> HwlocTopologyProcess::nCores() {
-  return pusPerCore.size();
-}
+  unsigned long topo_flags = HWLOC_TOPOLOGY_FLAG_WHOLE_SYSTEM |
+                             HWLOC_TOPOLOGY_FLAG_IO_DEVICES |
+                             HWLOC_TOPOLOGY_FLAG_IO_BRIDGES;
 
-process::Future<int> HwlocTopologyProcess::nProcessingUnits() {
-  process::Future<std::vector<int>> pu_vec = nProcessUnitsPerCore();
-  std::vector<int> puvec = pu_vec.get();
-  return std::accumulate(puvec.begin(), puvec.end(), 0);
-}
+  if(xmlPath.isSome()) {
+    if(hwloc_topology_set_xml(topology, xmlPath.get().c_str())) {
+      hwloc_topology_destroy(topology);
+      return Error("hwloc could not read " + xmlPath.get());
+    }
 
-process::Future<std::vector<int>> HwlocTopologyProcess::nCoresPerSocket() {
-  std::vector<int> coreCounts;
+    if(thisSystem) {
+      topo_flags |= HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM;
+    }
+  }
+  else if(synthetic.isSome()) {
+    if(hwloc_topology_set_synthetic(topology, synthetic.get().c_str())) {
+      hwloc_topology_destroy(topology);
+      return Error("hwloc could not parse '" + synthetic.get() + "'");
+    }
+  }
 
-  foreachvalue(std::vector<hwloc_obj_t> socket_cores, coresPerSocket) {
-    coreCounts.push_back(socket_cores.size());
+  hwloc_topology_set_flags(topology, topo_flags);
+
+  if(hwloc_topology_load(topology)) {
+    hwloc_topology_destroy(topology);
+    return Error("hwloc topology load failed");
   }
 
-  return coreCounts;
+  return Nothing();
 }
 
-int HwlocTopologyProcess::getCoreIndex(
-  hwloc_obj_t core)
-{
-  int count = 0;
-  foreachvalue(std::vector<hwloc_obj_t> socket_cores, coresPerSocket) {
-    vector<hwloc_obj_t>::iterator i =
-        find(socket_cores.begin(), socket_cores.end(), core);
-    if(i == socket_cores.end()) {  return -1; }
-    count+=1;
+void HwlocTopologyProcess::initialize() {
+  if(liveTopology && options.hotplugInterval > 0.0) {
+    process::delay(Seconds(options.hotplugInterval), self(),
+      &HwlocTopologyProcess::checkHotplug);
+  }
+}
+
+process::Future<uint64_t> HwlocTopologyProcess::changed(
+  const uint64_t generation) {
+  const uint64_t current = topology_snapshot()->generation;
+  if(current > generation) {
+    return current;
   }
 
-  return count;
+  process::Owned< process::Promise<uint64_t> > promise(
+    new process::Promise<uint64_t>());
+  watchers.push_back(promise);
+  return promise->future();
 }
 
-process::Future<std::vector<int>> HwlocTopologyProcess::nProcessUnitsPerCore() {
-  std::vector<int> puCounts;
+void HwlocTopologyProcess::checkHotplug() {
+  Option<CoreMask> cpus = available_cpus();
+
+  if(cpus.isSome() && cpus.get() != topology_snapshot()->onlineCpus) {
+    const std::shared_ptr<const TopologySnapshot> pinned = topology_snapshot();
+    const TopologySnapshot& snapshot = *pinned;
+
+    // a cpu that was offline at discovery has no
+    // core, only a fresh discovery can place it
+    bool known = true;
+    foreach(const int cpu, cpus.get()) {
+      if(snapshot.getCoreForCpu(cpu) < 0) {
+        known = false;
+        break;
+      }
+    }
+
+    LOG(INFO) << "Usable cpus changed from " << snapshot.onlineCpus.size()
+              << " to " << cpus.get().size()
+              << (known ? "" : ", rediscovering the topology");
+
+    if(known) {
+      publishOnlineCpus(cpus.get());
+    }
+    else {
+      // the loaded topology stays until the new
+      // one is in, a failed discovery keeps the
+      // published snapshot and is tried again on
+      // the next check
+      const hwloc_topology_t previous = topology;
+
+      Try<Nothing> loaded = loadTopology(None());
+      if(loaded.isError()) {
+        LOG(WARNING) << "Topology rediscovery failed, keeping the previous one: "
+                     << loaded.error();
+        topology = previous;
+
+        process::delay(Seconds(options.hotplugInterval), self(),
+          &HwlocTopologyProcess::checkHotplug);
+        return;
+      }
+
+      hwloc_topology_destroy(previous);
 
-  foreachvalue(std::vector<hwloc_obj_t> core_pu, pusPerCore) {
-    puCounts.push_back(core_pu.size());
+      root = hwloc_get_root_obj(topology);
+      coreDistmat = hwloc_get_whole_distance_matrix_by_type(topology,
+                                                            HWLOC_OBJ_CORE);
+      gpus.clear();
+      discoverGpuTopology(topology, root, NULL);
+
+      publishSnapshot();
+    }
+
+    const uint64_t generation = topology_snapshot()->generation;
+    foreach(const process::Owned< process::Promise<uint64_t> >& watcher, watchers) {
+      watcher->set(generation);
+    }
+
+    watchers.clear();
   }
 
-  return puCounts;
+  process::delay(Seconds(options.hotplugInterval), self(),
+    &HwlocTopologyProcess::checkHotplug);
 }
 
-static inline bool find_parent_by_type(
-  hwloc_obj_t halt,
-  hwloc_obj_t obj,
-  const hwloc_obj_type_t T)
-{
-  for(hwloc_obj_t cur = obj; cur != NULL && cur != halt; cur = cur->parent) {
-    if(cur->type == T) { return true; }
+void HwlocTopologyProcess::publishOnlineCpus(const CoreMask& cpus) {
+  TopologySnapshot* snapshot = new TopologySnapshot(*topology_snapshot());
+  snapshot->onlineCpus = cpus;
+  snapshot->buildIndex();
+  publish_topology_snapshot(snapshot);
+}
+
+bool HwlocTopologyProcess::matchesMachine() {
+  Try<std::string> online = os::read("/sys/devices/system/cpu/online");
+  if(online.isError()) {
+    return false;
   }
 
-  return false;
+  hwloc_bitmap_t online_cpus = hwloc_bitmap_alloc();
+  hwloc_bitmap_list_sscanf(online_cpus, strings::trim(online.get()).c_str());
+
+  const bool same =
+    hwloc_bitmap_isequal(online_cpus, hwloc_topology_get_online_cpuset(topology)) &&
+    (hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_PU) == hwloc_bitmap_weight(online_cpus));
+
+  hwloc_bitmap_free(online_cpus);
+  return same;
 }
 
-void HwlocTopologyProcess::discoverCpuTopology(
-  hwloc_topology_t topology,
-  hwloc_obj_t parent,
-  hwloc_obj_t child)
-{
-  hwloc_obj_t component;
-  component = hwloc_get_next_child(topology, parent, child);
+HwlocTopologyProcess::HwlocTopologyProcess(
+  const HwlocTopologyOptions& options_)
+  : options(options_) {
+  bool cached = false;
 
-  if (NULL == component) {
-    return;
+  liveTopology = true;
+
+  if(options.xmlPath.isSome() || options.synthetic.isSome()) {
+    Try<Nothing> loaded = loadTopology(options.xmlPath, options.synthetic, false);
+    if(loaded.isError()) {
+      error(-1, 1, "%s: %s", __func__, loaded.error().c_str());
+    }
+
+    liveTopology = false;
+    cached = true;
   }
+  else if(options.cachePath.isSome() && os::exists(options.cachePath.get())) {
+    Try<Nothing> loaded = loadTopology(options.cachePath);
 
-  // add vector of cores to socket map
-  if (component->type == HWLOC_OBJ_SOCKET) {
-    std::vector<hwloc_obj_t> cores_vec;
-    coresPerSocket.insert(std::make_pair(component, cores_vec));
+    if(loaded.isError()) {
+      LOG(WARNING) << "Ignoring topology cache: " << loaded.error();
+    }
+    else if(!matchesMachine()) {
+      LOG(WARNING) << "Topology cache " << options.cachePath.get()
+                   << " does not match the online cpus, rediscovering";
+      hwloc_topology_destroy(topology);
+    }
+    else {
+      cached = true;
+    }
   }
 
-  else if(component->type == HWLOC_OBJ_NODE) {
-    std::vector<unsigned> cores_vec;
-    unsigned numa_os_index = component->os_index;
-    coresPerNuma.insert( std::make_pair(numa_os_index, cores_vec) );
+  if(!cached) {
+    Try<Nothing> loaded = loadTopology(None());
+    if(loaded.isError()) {
+      error(-1, 1, "%s: %s", __func__, loaded.error().c_str());
+    }
+
+    if(options.cachePath.isSome() &&
+       hwloc_topology_export_xml(topology, options.cachePath.get().c_str())) {
+      LOG(WARNING) << "Failed to write topology cache "
+                   << options.cachePath.get();
+    }
   }
 
-  // add core to socket
-  else if (component->type == HWLOC_OBJ_CORE) {
-    const unsigned core_os_index = component->os_index;
+  root = hwloc_get_root_obj(topology);
 
-    foreachpair(
-      hwloc_obj_t socket,
-      vector<hwloc_obj_t> cores,
-      coresPerSocket)
-    {
+  coreDistmat = hwloc_get_whole_distance_matrix_by_type(topology,
+                                                      HWLOC_OBJ_CORE);
 
-      if(find_parent_by_type(socket, component, HWLOC_OBJ_SOCKET)) {
-        cores.push_back(component);
-        coresPerSocket.insert(std::make_pair(socket, cores));
+  discoverGpuTopology(topology, root, NULL);
 
-        if (find_parent_by_type(root, component, HWLOC_OBJ_NODE)) {
-          const unsigned numa_os_index = component->os_index;
+  publishSnapshot();
+}
 
-          if(coresPerNuma.count(numa_os_index)) {
-            coresPerNuma[numa_os_index].push_back(core_os_index);
-          }
-          else {
-            std::vector<unsigned> cores_vec;
-            unsigned numa_os_index = component->os_index;
-            coresPerNuma.insert( std::make_pair(numa_os_index, cores_vec) );
-          }
-        }
-      }
+process::Future<int> HwlocTopologyProcess::nSockets() {
+  return topology_snapshot()->nSockets();
+}
 
-    }
+process::Future<int> HwlocTopologyProcess::nCores() {
+  return topology_snapshot()->nCores();
+}
 
-  }
+process::Future<int> HwlocTopologyProcess::nProcessingUnits() {
+  return topology_snapshot()->nProcessingUnits();
+}
 
-  // add pu to core
-  else if (component->type == HWLOC_OBJ_PU) {
-    if(find_parent_by_type(parent, component, HWLOC_OBJ_CORE)) {
-      std::map< hwloc_obj_t, std::vector<hwloc_obj_t> >::iterator pu_core =
-        pusPerCore.find(parent);
+process::Future<std::vector<int>> HwlocTopologyProcess::nCoresPerSocket() {
+  const std::shared_ptr<const TopologySnapshot> pinned = topology_snapshot();
+  const TopologySnapshot& snapshot = *pinned;
+  std::vector<int> coreCounts(snapshot.nSockets(), 0);
 
-      if(pu_core == pusPerCore.end()) {
-        std::vector<hwloc_obj_t> pusvec;
-        pusvec.push_back(component);
-        pusPerCore.insert(std::make_pair(parent, pusvec));
-      }
-      else {
-        pu_core->second.push_back(component);
-      }
+  foreach(const int socket, snapshot.coreSocket) {
+    if(socket >= 0 && socket < static_cast<int>(coreCounts.size())) {
+      coreCounts[socket]++;
     }
   }
 
-  if(0 != component->arity) {
-    /* This device has children so need to look recursively at them */
-    discoverCpuTopology(topology, component, NULL);
-    discoverCpuTopology(topology, parent, component);
-  }
-  else {
-    discoverCpuTopology(topology, parent, component);
-  }
+  return coreCounts;
+}
+
+int HwlocTopologyProcess::getCoreIndex(
+  hwloc_obj_t core)
+{
+  return (core != NULL && core->type == HWLOC_OBJ_CORE) ?
+    static_cast<int>(core->logical_index) : -1;
+}
+
+process::Future<std::vector<int>> HwlocTopologyProcess::nProcessUnitsPerCore() {
+  return topology_snapshot()->pusPerCore;
 }
 
 // modified from http://icl.cs.utk.edu/open-mpi/faq/?category=runcuda
@@ -320,11 +848,14 @@ process::Future<std::vector<int> > HwlocTopologyProcess::getCudaCpus() {
       dev,
       gpu_associated_cpuset);
 
-    for(int j = 0; j < coresPerSocket.size(); j++) {
-      for(int k = 0; j < coresPerSocket[j].size(); k++) {
-        if(hwloc_cpuset_intersects(gpu_associated_cpuset, coresPerSocket[j][k]->cpuset)) {
-          cpus.push_back(coresPerSocket[j][k]->os_index);
-        }
+    // logical cores, the scheduler's items
+    const std::shared_ptr<const TopologySnapshot> pinned = topology_snapshot();
+    const TopologySnapshot& snapshot = *pinned;
+    const CoreMask cpuset = bitmap_to_mask(gpu_associated_cpuset);
+
+    foreach(const int core, snapshot.getCoresForCpus(cpuset)) {
+      if(std::find(cpus.begin(), cpus.end(), core) == cpus.end()) {
+        cpus.push_back(core);
       }
     }
 
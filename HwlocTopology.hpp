@@ -95,17 +95,22 @@
 
 #include <vector>
 #include <map>
+#include <string>
 
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
+#include <process/delay.hpp>
 
 #include <stout/try.hpp>
 #include <stout/option.hpp>
+#include <stout/nothing.hpp>
 
 #include <hwloc.h>
 
+#include "TopologySnapshot.hpp"
+
 #ifdef USE_CUDA
 
 #include <cuda.h>
@@ -114,6 +119,45 @@
 
 using namespace std;
 
+struct HwlocTopologyOptions {
+  HwlocTopologyOptions()
+    : calibrationSeconds(5.0), hotplugInterval(5.0) {
+  }
+
+  // hwloc xml export of the discovered topology,
+  // reloaded on startup while it still matches
+  // the machine's pus and online cpu mask
+  Option<std::string> cachePath;
+
+  // load this xml file instead of discovering
+  // the machine, never validated or cached
+  Option<std::string> xmlPath;
+
+  // build a synthetic topology from an hwloc
+  // description, "socket:2 node:2 l3:1 core:8 pu:2"
+  Option<std::string> synthetic;
+
+  // leveldb holding measured core to core
+  // latencies, calibrate when the topology
+  // has no entry yet (live machines only)
+  Option<std::string> calibrationPath;
+
+  // upper bound on a calibration pass
+  double calibrationSeconds;
+
+  // seconds between checks of the online and
+  // effective cpus, 0 disables the watcher
+  double hotplugInterval;
+};
+
+// parse the 'topology' module parameter,
+// "xml:<path>" or "synthetic:<description>",
+// a synthetic description may also be read
+// from a file (see topologies/)
+Try<Nothing> parse_topology_source(
+  const std::string& source,
+  HwlocTopologyOptions& options);
+
 class HwlocTopologyProcess : 
   public process::Process<HwlocTopologyProcess> 
 {
@@ -125,7 +169,8 @@ public:
   // detects hwloc support
   // finds all relevant devices
   // system components
-  HwlocTopologyProcess(); 
+  HwlocTopologyProcess(
+    const HwlocTopologyOptions& options = HwlocTopologyOptions()); 
 
   // get the number of sockets
   // hwloc found
@@ -155,14 +200,50 @@ public:
 
   process::Future<std::vector<int> > getCudaCpus();
 
+  // completes with the generation of the first
+  // snapshot published after 'generation'
+  process::Future<uint64_t> changed(const uint64_t generation);
+
+protected:
+
+  virtual void initialize();
+
 private:
 
-  void discoverGpuTopology(
-    hwloc_topology_t topology,
-    hwloc_obj_t parent,
-    hwloc_obj_t child);
+  // compare the online/effective cpus with the
+  // snapshot, republish when they differ
+  void checkHotplug();
+
+  // publish a copy of the current snapshot
+  // with a new set of usable cpus
+  void publishOnlineCpus(const CoreMask& cpus);
 
-  void discoverCpuTopology(
+  // init and load the topology, from the xml
+  // file or synthetic description when given
+  Try<Nothing> loadTopology(
+    const Option<std::string>& xmlPath,
+    const Option<std::string>& synthetic = None(),
+    const bool thisSystem = true);
+
+  // does the loaded topology describe
+  // the pus currently online
+  bool matchesMachine();
+
+  // flatten the discovered topology
+  // and publish it for lock-free reads
+  void publishSnapshot();
+
+  // core x core distances from the cache/numa/
+  // socket levels two cores share, weighted by
+  // the numa distance table, used when hwloc
+  // has no core distance matrix
+  void deriveCoreDistances(TopologySnapshot& snapshot);
+
+  // pci and os devices, and the cores
+  // and numa node local to each
+  void discoverIoDevices(TopologySnapshot& snapshot);
+
+  void discoverGpuTopology(
     hwloc_topology_t topology,
     hwloc_obj_t parent,
     hwloc_obj_t child);
@@ -179,15 +260,8 @@ private:
   // node in the hwloc topology
   hwloc_obj_t root;
 
-  // keys are sockets, values are cores
-  std::map< hwloc_obj_t, std::vector<hwloc_obj_t> > coresPerSocket;
-
-  // keys are numa nodes, values are cores
-  std::map< unsigned, std::vector<unsigned > > coresPerNuma;
-
-  // keys are cores, values are processing units
-  std::map< hwloc_obj_t, std::vector<hwloc_obj_t> > pusPerCore;
-
+  // logical index of a core object, the
+  // snapshot's tables are keyed on it
   int getCoreIndex(hwloc_obj_t core);
 
   // all detected gpus
@@ -196,13 +270,40 @@ private:
   // stores a distance matrix (latency)
   // between all cores on the system
   const struct hwloc_distances_s* coreDistmat;
+
+  // topology describes this machine (discovered
+  // or cached), not an xml/synthetic input
+  bool liveTopology;
+
+  const HwlocTopologyOptions options;
+
+  // changed() callers waiting on a new snapshot
+  std::vector< process::Owned< process::Promise<uint64_t> > > watchers;
 };
 
 class HwlocTopology {
 
 public:
 
-  HwlocTopology() {}
+  HwlocTopology(
+    const HwlocTopologyOptions& options = HwlocTopologyOptions())
+    : process(new HwlocTopologyProcess(options)) {
+    spawn(process.get());
+  }
+
+  // process-wide topology; hwloc discovery runs
+  // once, on the first call, and every isolator,
+  // assigner and estimator shares the same actor.
+  // options are only used by the first call
+  static HwlocTopology& shared(
+    const HwlocTopologyOptions& options = HwlocTopologyOptions());
+
+  // latest snapshot of the shared topology,
+  // held for as long as the caller keeps it
+  static std::shared_ptr<const TopologySnapshot> snapshot() {
+    shared();
+    return topology_snapshot();
+  }
 
   process::Future<int> nSockets() {
     return dispatch(process.get(),
@@ -237,8 +338,6 @@ public:
       i, j);
   }
 
-  process::Future<int> getCoreIndex(hwloc_obj_t core);
-
   process::Future<int> getNumaForCore(const int core) {
     return dispatch(process.get(),
       &HwlocTopologyProcess::getNumaForCore,
@@ -250,6 +349,14 @@ public:
       &HwlocTopologyProcess::getCudaCpus);
   }
 
+  // cpu hotplug or a cpuset.effective_cpus change
+  // published a snapshot newer than 'generation'
+  process::Future<uint64_t> changed(const uint64_t generation) {
+    return dispatch(process.get(),
+      &HwlocTopologyProcess::changed,
+      generation);
+  }
+
   virtual ~HwlocTopology() {
     terminate(process.get());
     wait(process.get());
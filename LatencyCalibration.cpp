@@ -0,0 +1,352 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+
+#include <leveldb/db.h>
+
+#include <stout/foreach.hpp>
+
+#include <glog/logging.h>
+
+#include "LatencyCalibration.hpp"
+
+// round trips per batch, the best batch is kept
+static const int PINGPONG_ROUNDTRIPS = 100;
+static const int PINGPONG_BATCHES = 5;
+static const int PINGPONG_WARMUP = 50;
+
+// pairs considered on large machines
+static const size_t MAX_CANDIDATE_PAIRS = 1 << 16;
+
+static const uint64_t FNV_OFFSET = UINT64_C(14695981039346656037);
+static const uint64_t FNV_PRIME = UINT64_C(1099511628211);
+
+static void fnv_ints(uint64_t& h, const std::vector<int>& values) {
+  foreach(const int v, values) {
+    const uint32_t u = static_cast<uint32_t>(v);
+    for(int b = 0; b < 4; b++) {
+      h ^= (u >> (8 * b)) & 0xff;
+      h *= FNV_PRIME;
+    }
+  }
+
+  // separate the vectors
+  h ^= 0xff;
+  h *= FNV_PRIME;
+}
+
+std::string topology_fingerprint(const TopologySnapshot& snapshot) {
+  uint64_t h = FNV_OFFSET;
+
+  fnv_ints(h, snapshot.coreOsIndex);
+  fnv_ints(h, snapshot.coreSocket);
+  fnv_ints(h, snapshot.coreNuma);
+  fnv_ints(h, snapshot.coreL2);
+  fnv_ints(h, snapshot.coreL3);
+  fnv_ints(h, snapshot.coreGroup);
+  fnv_ints(h, snapshot.puOsIndex);
+  fnv_ints(h, snapshot.puCore);
+
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+  return std::string(buf);
+}
+
+static bool pin_thread(const int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// the bounced line, alone in its cache line
+struct alignas(64) PingPongLine {
+  std::atomic<unsigned> seq;
+  char pad[64 - sizeof(std::atomic<unsigned>)];
+};
+
+// one way latency in ns between two cpus (os
+// indices), negative if either can't be pinned
+static float ping_pong(const int cpua, const int cpub) {
+  PingPongLine line;
+  line.seq.store(0);
+
+  std::atomic<int> ready(0);
+  std::atomic<bool> failed(false);
+  const unsigned total = PINGPONG_WARMUP + (PINGPONG_BATCHES * PINGPONG_ROUNDTRIPS);
+
+  double best = std::numeric_limits<double>::infinity();
+
+  std::thread pong([&]() {
+    if(!pin_thread(cpub)) { failed.store(true); }
+    ready.fetch_add(1);
+    while(ready.load() < 2) {}
+    if(failed.load()) { return; }
+
+    for(unsigned k = 0; k < total; k++) {
+      while(line.seq.load(std::memory_order_acquire) != (2 * k) + 1) {}
+      line.seq.store((2 * k) + 2, std::memory_order_release);
+    }
+  });
+
+  std::thread ping([&]() {
+    if(!pin_thread(cpua)) { failed.store(true); }
+    ready.fetch_add(1);
+    while(ready.load() < 2) {}
+    if(failed.load()) { return; }
+
+    unsigned k = 0;
+    for(; k < PINGPONG_WARMUP; k++) {
+      line.seq.store((2 * k) + 1, std::memory_order_release);
+      while(line.seq.load(std::memory_order_acquire) != (2 * k) + 2) {}
+    }
+
+    for(int b = 0; b < PINGPONG_BATCHES; b++) {
+      const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+      for(int r = 0; r < PINGPONG_ROUNDTRIPS; r++, k++) {
+        line.seq.store((2 * k) + 1, std::memory_order_release);
+        while(line.seq.load(std::memory_order_acquire) != (2 * k) + 2) {}
+      }
+
+      const double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count();
+      best = std::min(best, ns);
+    }
+  });
+
+  ping.join();
+  pong.join();
+
+  if(failed.load()) {
+    return -1.0;
+  }
+
+  return static_cast<float>(best / (2.0 * PINGPONG_ROUNDTRIPS));
+}
+
+// pairs of cores with the same derived distance
+// and numa nodes should measure alike
+typedef std::tuple<float, int, int> PairClass;
+
+typedef std::pair<int, int> CorePair;
+
+static PairClass pair_class(
+  const TopologySnapshot& snapshot,
+  const int i,
+  const int j) {
+  const int a = snapshot.coreNuma[i];
+  const int b = snapshot.coreNuma[j];
+  return std::make_tuple(snapshot.getCoreDistance(i, j), std::min(a, b), std::max(a, b));
+}
+
+static Try<std::vector<float> > measure(
+  const TopologySnapshot& snapshot,
+  const double seconds) {
+  const int ncores = snapshot.ncores;
+
+  // first pu of every core
+  std::vector<int> cpu(ncores, -1);
+  for(int p = static_cast<int>(snapshot.puCore.size()) - 1; p >= 0; p--) {
+    const int core = snapshot.puCore[p];
+    if(core >= 0 && core < ncores) {
+      cpu[core] = snapshot.puOsIndex[p];
+    }
+  }
+
+  std::mt19937 engine(5489u);
+
+  // candidate pairs, every pair when there are
+  // few enough, a random sample otherwise
+  std::vector<CorePair> pairs;
+  const size_t npairs = (static_cast<size_t>(ncores) * (ncores - 1)) / 2;
+
+  if(npairs <= MAX_CANDIDATE_PAIRS) {
+    for(int i = 0; i < ncores; i++) {
+      for(int j = i + 1; j < ncores; j++) {
+        pairs.push_back(std::make_pair(i, j));
+      }
+    }
+  }
+  else {
+    std::uniform_int_distribution<int> core(0, ncores - 1);
+    while(pairs.size() < MAX_CANDIDATE_PAIRS) {
+      const int i = core(engine);
+      const int j = core(engine);
+      if(i != j) {
+        pairs.push_back(std::make_pair(std::min(i, j), std::max(i, j)));
+      }
+    }
+  }
+
+  std::shuffle(std::begin(pairs), std::end(pairs), engine);
+
+  // one pair of every class goes first
+  std::map<PairClass, int> seen;
+  std::vector<CorePair> firsts, rest;
+
+  foreach(const CorePair& p, pairs) {
+    if(seen[pair_class(snapshot, p.first, p.second)]++ == 0) {
+      firsts.push_back(p);
+    }
+    else {
+      rest.push_back(p);
+    }
+  }
+
+  pairs.swap(firsts);
+  pairs.insert(std::end(pairs), std::begin(rest), std::end(rest));
+
+  std::vector<float> latency(ncores * ncores, -1.0);
+
+  const std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(seconds));
+
+  size_t measured = 0;
+  foreach(const CorePair& p, pairs) {
+    if(std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+
+    if(cpu[p.first] < 0 || cpu[p.second] < 0) {
+      continue;
+    }
+
+    const float ns = ping_pong(cpu[p.first], cpu[p.second]);
+    if(ns >= 0.0) {
+      latency[p.first * ncores + p.second] = ns;
+      latency[p.second * ncores + p.first] = ns;
+      measured++;
+    }
+  }
+
+  LOG(INFO) << "Measured " << measured << " of " << npairs
+            << " core pairs";
+
+  if(measured == 0) {
+    return Error("no core pair could be pinned and measured");
+  }
+
+  // class means, and the ratio of measured
+  // latency to derived distance overall
+  std::map<PairClass, std::pair<double, int> > means;
+  double sumMeasured = 0.0;
+  double sumDerived = 0.0;
+
+  for(int i = 0; i < ncores; i++) {
+    for(int j = i + 1; j < ncores; j++) {
+      const float ns = latency[i * ncores + j];
+      if(ns >= 0.0) {
+        std::pair<double, int>& m = means[pair_class(snapshot, i, j)];
+        m.first += ns;
+        m.second++;
+        sumMeasured += ns;
+        sumDerived += snapshot.getCoreDistance(i, j);
+      }
+    }
+  }
+
+  const double scale = (sumDerived > 0.0) ? (sumMeasured / sumDerived) : 1.0;
+
+  for(int i = 0; i < ncores; i++) {
+    latency[i * ncores + i] = 0.0;
+
+    for(int j = i + 1; j < ncores; j++) {
+      if(latency[i * ncores + j] >= 0.0) {
+        continue;
+      }
+
+      std::map<PairClass, std::pair<double, int> >::const_iterator m =
+        means.find(pair_class(snapshot, i, j));
+
+      const float ns = (m != means.end()) ?
+        static_cast<float>(m->second.first / m->second.second) :
+        static_cast<float>(scale * snapshot.getCoreDistance(i, j));
+
+      latency[i * ncores + j] = ns;
+      latency[j * ncores + i] = ns;
+    }
+  }
+
+  return latency;
+}
+
+Try<std::vector<float> > calibrate_core_latency(
+  const TopologySnapshot& snapshot,
+  const std::string& dbpath,
+  const double seconds) {
+  const int ncores = snapshot.ncores;
+  const std::string key = "corelatency/" + topology_fingerprint(snapshot);
+
+  leveldb::DB* db = NULL;
+  leveldb::Options options;
+  options.create_if_missing = true;
+
+  leveldb::Status status = leveldb::DB::Open(options, dbpath, &db);
+  if(!status.ok()) {
+    return Error("failed to open " + dbpath + ": " + status.ToString());
+  }
+
+  std::string value;
+  status = db->Get(leveldb::ReadOptions(), key, &value);
+
+  if(status.ok() && value.size() == ncores * ncores * sizeof(float)) {
+    std::vector<float> latency(ncores * ncores);
+    std::copy(value.begin(), value.end(), reinterpret_cast<char*>(latency.data()));
+    delete db;
+    return latency;
+  }
+
+  LOG(INFO) << "Calibrating core latencies for topology " << key
+            << ", at most " << seconds << "s";
+
+  Try<std::vector<float> > latency = measure(snapshot, seconds);
+  if(latency.isError()) {
+    delete db;
+    return latency;
+  }
+
+  status = db->Put(leveldb::WriteOptions(), key,
+    std::string(reinterpret_cast<const char*>(latency.get().data()),
+                latency.get().size() * sizeof(float)));
+
+  if(!status.ok()) {
+    LOG(WARNING) << "Failed to store core latencies: " << status.ToString();
+  }
+
+  delete db;
+  return latency;
+}
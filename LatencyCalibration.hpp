@@ -0,0 +1,64 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  measured core to core latency
+//
+//  two threads, pinned to the first pu of each core,
+//  bounce a single cache line back and forth; half the
+//  best round trip time is the one way latency of the
+//  pair. this picks up what the cache/numa hierarchy
+//  can't describe, mesh or ring position, ccx and die
+//  boundaries.
+//
+//  all pairs are measured on small machines. larger
+//  machines measure one pair of every hierarchy class
+//  (same derived distance and numa pair) first, then
+//  random pairs until the time budget runs out. a pair
+//  that was never measured gets the mean of its class.
+//
+//  results are stored in a leveldb keyed by a
+//  fingerprint of the topology, a restart on the same
+//  machine reuses them without measuring again.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSLATENCYCALIBRATION__
+#define __MESOSLATENCYCALIBRATION__ 1
+
+#include <string>
+#include <vector>
+
+#include <stout/try.hpp>
+
+#include "TopologySnapshot.hpp"
+
+// stable hash of the cores, pus, caches and numa
+// nodes in the snapshot, distances are not included
+std::string topology_fingerprint(const TopologySnapshot& snapshot);
+
+// ncores x ncores one way latencies in nanoseconds,
+// row major with a zero diagonal. read from the
+// leveldb at dbpath when this topology was calibrated
+// before, measured for at most 'seconds' and stored
+// otherwise. the snapshot's derived distances are
+// used to group pairs that were not measured.
+Try<std::vector<float> > calibrate_core_latency(
+  const TopologySnapshot& snapshot,
+  const std::string& dbpath,
+  const double seconds);
+
+#endif
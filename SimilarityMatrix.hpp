@@ -0,0 +1,286 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  dense core x core similarity matrix
+//
+//  rows are stored flat, cache line aligned and padded
+//  with zeros to a multiple of 16 floats, so the
+//  coverage kernels below can stream a row with
+//  aligned SSE/AVX loads and no tail loop. padding
+//  lanes carry zero similarity and zero capacity and
+//  never contribute to a gain.
+//
+//  the kernels are selected at compile time, build
+//  with -mavx (or -march=native) to get the 8 lane
+//  path, x86_64 always has the 4 lane SSE path and
+//  every other target falls back to scalar code.
+//  each path keeps two accumulators to hide the
+//  latency of the add chain.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSSIMILARITYMATRIX__
+#define __MESOSSIMILARITYMATRIX__ 1
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+// zero initialized, cache line aligned float array
+class AlignedFloats {
+
+public:
+
+  static const int ALIGN = 64;
+
+  static const int LANES = ALIGN / sizeof(float);
+
+  static int padded(const int n) {
+    return ((n + LANES - 1) / LANES) * LANES;
+  }
+
+  AlignedFloats() : data(NULL), n(0) {
+  }
+
+  explicit AlignedFloats(const int n_) : data(NULL), n(0) {
+    resize(n_);
+  }
+
+  AlignedFloats(const AlignedFloats& o) : data(NULL), n(0) {
+    resize(o.n);
+    if(n) {
+      std::memcpy(data, o.data, n * sizeof(float));
+    }
+  }
+
+  AlignedFloats& operator=(const AlignedFloats& o) {
+    if(this != &o) {
+      if(n != o.n) {
+        resize(o.n);
+      }
+      if(n) {
+        std::memcpy(data, o.data, n * sizeof(float));
+      }
+    }
+
+    return *this;
+  }
+
+  ~AlignedFloats() {
+    std::free(data);
+  }
+
+  void resize(const int n_) {
+    std::free(data);
+    data = NULL;
+    n = n_;
+
+    if(n > 0) {
+      void* ptr = NULL;
+      if(posix_memalign(&ptr, ALIGN, n * sizeof(float)) != 0) {
+        throw std::bad_alloc();
+      }
+
+      data = static_cast<float*>(ptr);
+      std::memset(data, 0, n * sizeof(float));
+    }
+  }
+
+  int size() const {
+    return n;
+  }
+
+  float* get() {
+    return data;
+  }
+
+  const float* get() const {
+    return data;
+  }
+
+  float& operator[](const int i) {
+    return data[i];
+  }
+
+  float operator[](const int i) const {
+    return data[i];
+  }
+
+private:
+  float* data;
+  int n;
+
+};
+
+class SimilarityMatrix {
+
+public:
+
+  SimilarityMatrix() : n(0), stride(0) {
+  }
+
+  // build from a policy's getSimilarity(i, j)
+  template< typename Similarity >
+  void build(const int n_, Similarity& sim) {
+    n = n_;
+    stride = AlignedFloats::padded(n);
+    mat.resize(n * stride);
+
+    for(int i = 0; i < n; i++) {
+      float* rowi = row(i);
+      for(int j = 0; j < n; j++) {
+        rowi[j] = static_cast<float>(sim.getSimilarity(i, j));
+      }
+    }
+  }
+
+  // number of cores
+  int size() const {
+    return n;
+  }
+
+  // padded length of a row
+  int width() const {
+    return stride;
+  }
+
+  float operator()(const int i, const int j) const {
+    return mat[i * stride + j];
+  }
+
+  float* row(const int i) {
+    return mat.get() + (i * stride);
+  }
+
+  const float* row(const int i) const {
+    return mat.get() + (i * stride);
+  }
+
+private:
+  int n;
+  int stride;
+  AlignedFloats mat;
+
+};
+
+// the coverage_gain path this build uses
+static inline const char* coverage_kernel() {
+#if defined(__AVX__)
+  return "avx";
+#elif defined(__SSE__)
+  return "sse";
+#else
+  return "scalar";
+#endif
+}
+
+// sum_i min(cover_i + w * row_i, cap_i) - min(cover_i, cap_i)
+//
+static inline float coverage_gain(
+  const float* row,
+  const float w,
+  const float* cover,
+  const float* cap,
+  const int width) {
+
+#if defined(__AVX__)
+
+  const __m256 vw = _mm256_set1_ps(w);
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+
+  for(int i = 0; i < width; i += 16) {
+    const __m256 c0 = _mm256_load_ps(cover + i);
+    const __m256 c1 = _mm256_load_ps(cover + i + 8);
+    const __m256 k0 = _mm256_load_ps(cap + i);
+    const __m256 k1 = _mm256_load_ps(cap + i + 8);
+    const __m256 n0 = _mm256_add_ps(c0, _mm256_mul_ps(vw, _mm256_load_ps(row + i)));
+    const __m256 n1 = _mm256_add_ps(c1, _mm256_mul_ps(vw, _mm256_load_ps(row + i + 8)));
+    acc0 = _mm256_add_ps(acc0,
+      _mm256_sub_ps(_mm256_min_ps(n0, k0), _mm256_min_ps(c0, k0)));
+    acc1 = _mm256_add_ps(acc1,
+      _mm256_sub_ps(_mm256_min_ps(n1, k1), _mm256_min_ps(c1, k1)));
+  }
+
+  const __m256 acc = _mm256_add_ps(acc0, acc1);
+  const __m128 hi = _mm256_extractf128_ps(acc, 1);
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), hi);
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+
+#elif defined(__SSE__)
+
+  const __m128 vw = _mm_set1_ps(w);
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+
+  for(int i = 0; i < width; i += 8) {
+    const __m128 c0 = _mm_load_ps(cover + i);
+    const __m128 c1 = _mm_load_ps(cover + i + 4);
+    const __m128 k0 = _mm_load_ps(cap + i);
+    const __m128 k1 = _mm_load_ps(cap + i + 4);
+    const __m128 n0 = _mm_add_ps(c0, _mm_mul_ps(vw, _mm_load_ps(row + i)));
+    const __m128 n1 = _mm_add_ps(c1, _mm_mul_ps(vw, _mm_load_ps(row + i + 4)));
+    acc0 = _mm_add_ps(acc0, _mm_sub_ps(_mm_min_ps(n0, k0), _mm_min_ps(c0, k0)));
+    acc1 = _mm_add_ps(acc1, _mm_sub_ps(_mm_min_ps(n1, k1), _mm_min_ps(c1, k1)));
+  }
+
+  __m128 acc = _mm_add_ps(acc0, acc1);
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+  return _mm_cvtss_f32(acc);
+
+#else
+
+  float delta = 0.0;
+
+  for(int i = 0; i < width; i++) {
+    const float c = cover[i];
+    delta += std::min(c + w * row[i], cap[i]) - std::min(c, cap[i]);
+  }
+
+  return delta;
+
+#endif
+}
+
+// cover_i += w * row_i, returns sum_i min(cover_i, cap_i)
+//
+static inline float coverage_add(
+  const float* row,
+  const float w,
+  float* cover,
+  const float* cap,
+  const int width) {
+
+  float total = 0.0;
+
+  for(int i = 0; i < width; i++) {
+    cover[i] += w * row[i];
+    total += std::min(cover[i], cap[i]);
+  }
+
+  return total;
+}
+
+#endif
@@ -32,9 +32,44 @@
 //  cost of work being currently performed on the
 //  core being considered
 //
+//  the budget is a number of cores (rounded up),
+//  a core's cost only divides its gain. cores of
+//  infinite cost are never selected.
+//
 //  By default the least expensive core will be
 //  will be selected.
 //
+//  LAZY_GREEDY mode implements the accelerated
+//  greedy algorithm described in,
+//
+//  "Accelerated greedy algorithms for maximizing
+//   submodular set functions" by M. Minoux
+//
+//  marginal gains only shrink as G grows, so the
+//  last computed gain of a core is an upper bound
+//  on its current gain. cores are kept in a max-heap
+//  keyed on that bound and only the top of the heap
+//  is re-evaluated. ties are broken on the lowest
+//  core index, matching the GREEDY scan order.
+//
+//  STOCHASTIC_GREEDY mode implements the sampling
+//  greedy algorithm described in,
+//
+//  "Lazier Than Lazy Greedy" by Mirzasoleiman,
+//   Badanidiyuru, Karbasi, Vondrak & Krause
+//
+//  each round only evaluates a random sample of
+//  (n / k) log(1 / epsilon) cores from U, where k is
+//  the budget. in expectation the placement is within
+//  (1 - 1/e - epsilon) of the optimum.
+//
+//  policies group cores into domains (shared cache,
+//  die, numa node, socket) with getDomains(), finest
+//  level first. the placement over every core sets
+//  the number of cores, it is then redone inside each
+//  domain of the finest level that can hold that many
+//  and only spans domains when none can.
+//
 //  ct.clmsn
 //
 
@@ -50,181 +85,444 @@
 #include <iterator>
 #include <cmath>
 #include <random>
+#include <queue>
+#include <numeric>
+#include <functional>
+#include <memory>
 
 #include "stout/foreach.hpp"
 
+#include "CoreMask.hpp"
+#include "CoverageState.hpp"
+
 using namespace std;
 
+enum SubmodularSchedulerMode {
+  GREEDY,
+  LAZY_GREEDY,
+  STOCHASTIC_GREEDY
+};
+
+struct SubmodularSchedulerOptions {
+  SubmodularSchedulerOptions(
+    const SubmodularSchedulerMode mode_ = LAZY_GREEDY,
+    const float epsilon_ = 0.1,
+    const unsigned seed_ = 5489u)
+    : mode(mode_), epsilon(epsilon_), seed(seed_) {
+  }
+
+  SubmodularSchedulerMode mode;
+
+  // STOCHASTIC_GREEDY sample size parameter
+  float epsilon;
+
+  // STOCHASTIC_GREEDY engine seed
+  unsigned seed;
+};
+
 template< typename IndexSetPolicy >
 class SubmodularScheduler : private IndexSetPolicy {
   using IndexSetPolicy::getItems;
   using IndexSetPolicy::getCostVector;
   using IndexSetPolicy::getWeightVector;
+  using IndexSetPolicy::getDomains;
 
 private:
 
-  std::set<int> U, V;
+  CoreMask U, V;
 
-  float C(
-    const std::valarray<float>& weights,
-    const std::set<int>& S,
-    const int i) {
+  SubmodularSchedulerMode mode;
 
-    const float ret = std::accumulate(std::begin(S), std::end(S), 0.0,
-      [&weights, i] (int j, int k) {
-        return weights[i, j] + weights[i, k];
-      });
+  float epsilon;
 
-    return ret;
-  }
+  std::mt19937 engine;
+
+  // U gathered for sampling, reserved
+  // once per placement
+  std::vector<int> sample;
+
+  // f of the last placement
+  float fbest;
+
+  // core x core similarity, built from
+  // the policy on the first placement
+  // unless one is passed in
+  SimilarityMatrix similarity;
+
+  // the matrix placements read, 'similarity'
+  // or one built elsewhere (useSimilarity)
+  const SimilarityMatrix* matrix;
+
+  // number of calls made to f
+  // during the last placement
+  unsigned long nevals;
+
+  // C_i(V) is fixed for a placement, L()
+  // starts from a copy of this empty state
+  std::unique_ptr<CoverageState> empty;
+
+  // a cached marginal gain, valid
+  // while G has 'stamp' elements
+  struct LazyGain {
+    int item;
+    float gain;
+    float delta;
+    int stamp;
+  };
+
+  struct lazy_cmp {
+    bool operator()(const LazyGain& a, const LazyGain& b) const {
+      return (a.gain < b.gain) || (a.gain == b.gain && a.item > b.item);
+    }
+  };
+
+  typedef std::priority_queue<LazyGain, std::vector<LazyGain>, lazy_cmp> LazyHeap;
 
   // similarity function
   float L(
     const std::valarray<float>& weights,
-    const std::set<int>& S,
+    const CoreMask& S,
     const float alpha = 1.0) {
 
-    std::set<int> Vcpy = V;
-    std::vector<float> Vvec;
+    CoverageState state = (empty && alpha == 1.0) ?
+      *empty : CoverageState(*matrix, weights, V, alpha);
 
-    for(auto i : S) {
-      std::vector<float> cvec = { C(weights, S, i), alpha * C(weights, Vcpy, i) };
-      Vvec.push_back((*std::min_element(std::begin(cvec), std::end(cvec))));
-    } 
+    foreach(int j, S) {
+      state.add(j);
+    }
 
-    const float Lret = std::accumulate(std::begin(Vvec), std::end(Vvec), 0.0, std::plus<float>());
-    return Lret;
+    return state.value();
   }
 
   // coverage, "fidelity" function
   float f(
     const std::valarray<float>& weights, 
-    std::set<int> S) {
+    const CoreMask& S) {
 
+    nevals++;
     return L(weights, S); // + lambda * R(weights, S);
   }
 
-  static bool pair_cmp(
-    std::pair<int, float> a,
-    std::pair<int, float> b) {
-    return (a.second < b.second);
+  // pick the core with the largest gain per cost
+  // from the lazy heap; entries stamped with the
+  // current size of G are exact
+  //
+  LazyGain lazy_pick(
+    LazyHeap& heap,
+    const CoverageState& state,
+    const std::valarray<float>& cost,
+    const int Gsize,
+    const float r) {
+
+    while(heap.top().stamp != Gsize) {
+      LazyGain top = heap.top();
+      heap.pop();
+
+      nevals++;
+      top.delta = state.gain(top.item);
+      top.gain = top.delta / std::pow(cost[top.item], r);
+      top.stamp = Gsize;
+      heap.push(top);
+    }
+
+    const LazyGain k = heap.top();
+    heap.pop();
+    return k;
   }
 
-  static bool fin_cmp(
-    std::pair< std::set<int>, float> a,
-    std::pair< std::set<int>, float> b) {
+  // scan every core left in U, the first
+  // core with the largest gain per cost wins
+  //
+  LazyGain greedy_pick(
+    const CoverageState& state,
+    const std::valarray<float>& cost,
+    const float r) {
 
-    return a.second < b.second;
-  }
+    LazyGain k = { -1, -std::numeric_limits<float>::infinity(), 0.0, 0 };
 
-  static float sum_func(
-    float a, 
-    std::pair<int, float> b) {
+    foreach(int l, U) {
+      nevals++;
+      const float delta = state.gain(l);
+      const float gain = delta / std::pow(cost[l], r);
+
+      if(k.item < 0 || gain > k.gain) {
+        k.item = l;
+        k.gain = gain;
+        k.delta = delta;
+      }
+    }
 
-    return a + b.second;
+    return k;
   }
 
-public:
+  // evaluate a random sample of U, the
+  // first sampled core with the largest
+  // gain per cost wins
+  //
+  LazyGain stochastic_pick(
+    const CoverageState& state,
+    const std::valarray<float>& cost,
+    const int samplesize,
+    const float r) {
+
+    sample.clear();
+    foreach(int l, U) {
+      sample.push_back(l);
+    }
 
-  SubmodularScheduler() {
+    const int s = std::min(samplesize, static_cast<int>(sample.size()));
+    LazyGain k = { -1, -std::numeric_limits<float>::infinity(), 0.0, 0 };
+
+    for(int i = 0; i < s; i++) {
+      std::uniform_int_distribution<int> pick(i, sample.size() - 1);
+      std::swap(sample[i], sample[pick(engine)]);
+
+      const int l = sample[i];
+      nevals++;
+      const float delta = state.gain(l);
+      const float gain = delta / std::pow(cost[l], r);
+
+      if(k.item < 0 || gain > k.gain) {
+        k.item = l;
+        k.gain = gain;
+        k.delta = delta;
+      }
+    }
+
+    return k;
   }
 
-  void operator()(
-    std::set<int>& Gf,
+  // budgeted greedy placement over the
+  // cores in S, returns f of the placement
+  //
+  float place(
+    const CoreMask& S,
+    const std::valarray<float>& cost,
+    const std::valarray<float>& weights,
+    CoreMask& Gf,
     const float budget,
-    const float r = 1.0,
-    const float differenceEpsilon = 0.75) {
+    const float r) {
 
-  const std::vector<int> nCores = getItems();
+  U = S;
+  V = S;
 
-  // cost is the number of
-  // tasks per core / total
-  // tasks on cpu
-  //
-  std::valarray<float> cost =
-    getCostVector();
+  const float cmin = cost.min();
+  const int K = static_cast<int>(std::ceil(budget));
 
-  const float B = cost.min() * budget;
+  CoreMask G;
 
-  // num tasks per core weighted by num processing 
-  // units (physical threads) per core
+  empty.reset(new CoverageState(*matrix, weights, V));
+  CoverageState state = *empty;
+
+  // upper bounds on the marginal gains, seeded
+  // with +inf so every core is evaluated once
   //
-  std::valarray<float> weights =
-    getWeightVector();
+  std::vector<LazyGain> heapstore;
+  heapstore.reserve(S.size());
+  LazyHeap heap(lazy_cmp(), heapstore);
+
+  if(mode == LAZY_GREEDY) {
+    foreach(int l, U) {
+      LazyGain lg = { l, std::numeric_limits<float>::infinity(), 0.0, -1 };
+      heap.push(lg);
+    }
+  }
 
-  std::set<int> G;
+  // (n / k) log(1 / epsilon) cores per round
+  //
+  const int samplesize = static_cast<int>(std::ceil(
+    (V.size() / std::max(budget, 1.0f)) * std::log(1.0 / epsilon)));
 
-  for(int i = 0; i < nCores.size(); i++) {
-    U.insert(nCores[i]);
-    V.insert(nCores[i]);
+  if(mode == STOCHASTIC_GREEDY) {
+    sample.reserve(S.size());
   }
 
-  while(U.size() > 0) {
-    std::vector< std::pair<int, float> > pick_k;
+  int Gsize = 0;
 
-    foreach(int l, U) {
-      std::set<int> Gltmp = G;
-      Gltmp.insert(l);
-      const float cl = cost[l];
-      pick_k.push_back(
-        std::make_pair(l, (f(weights, Gltmp) - f(weights, G)) / std::pow(cl, r))
-      );
-    }
+  while(!U.empty() && Gsize < K) {
 
     // find the cheapest core to add to the list
     //
-    std::vector< std::pair<int, float> >::iterator k_itr =
-      std::max_element(pick_k.begin(), pick_k.end(), pair_cmp);
+    const LazyGain k = (mode == LAZY_GREEDY) ?
+      lazy_pick(heap, state, cost, Gsize, r) :
+      (mode == STOCHASTIC_GREEDY) ?
+      stochastic_pick(state, cost, samplesize, r) :
+      greedy_pick(state, cost, r);
+
+    if( std::isfinite(cost[k.item]) && (k.delta >= 0.0) ) {
+      G.insert(k.item);
+      state.add(k.item);
+      Gsize++;
+    }
 
-    std::vector< std::pair<int, float> > cost_test;
-    foreach(int obj_i, G) {
-      const float ci = cost[obj_i];
-      const float ck = cost[k_itr->first];
+    U.erase(k.item);
+  }
+
+  // the best single core of the cheapest ones
+  // only competes with a one core placement
+  //
+  int vstar = -1;
+  float fvstar = 0.0;
 
-      cost_test.push_back(
-        std::make_pair(obj_i, ci + ck)
-      );
+  foreach(int v, V) {
+    if(K == 1 && cost[v] <= cmin) {
+      CoreMask vset;
+      vset.insert(v);
+      const float fv = f(weights, vset);
+      if(vstar < 0 || fv > fvstar) {
+        vstar = v;
+        fvstar = fv;
+      }
     }
+  }
+
+  Gf = G;
+  float fG = f(weights, G);
 
-    std::set<int> Gktmp = G;
-    Gktmp.insert(k_itr->first);
+  if(vstar >= 0 && fG <= fvstar) {
+    Gf.clear();
+    Gf.insert(vstar);
+    fG = fvstar;
+  }
 
-    const float cost_test_sum = 
-      std::accumulate(cost_test.begin(), cost_test.end(), 0.0, sum_func);
+  empty.reset();
+  return fG;
+}
 
-    if( (cost_test_sum <= B) &&
-        ((f(weights, Gktmp) - f(weights, G)) >= 0.0) ) {
-      G.insert(k_itr->first);
-    }
+public:
 
-    U.erase(k_itr->first);
+  SubmodularScheduler(const SubmodularSchedulerMode mode_ = GREEDY)
+    : mode(mode_), epsilon(0.1), fbest(0.0), matrix(NULL), nevals(0) {
   }
 
-  std::vector< std::pair<int, float> > vlist;
-  foreach(int v, V) {
-    const float vitr = cost[v];
-    std::set<int> vset;
-    vset.insert(v);
-    if(vitr <= B) {
-      vlist.push_back( std::make_pair(v, f(weights, vset)) );
-    }
+  SubmodularScheduler(const SubmodularSchedulerOptions& options)
+    : mode(options.mode),
+      epsilon(options.epsilon),
+      engine(options.seed),
+      fbest(0.0),
+      matrix(NULL),
+      nevals(0) {
   }
 
-  std::vector< pair<int, float> >::iterator vstar =
-    std::max_element(vlist.begin(), vlist.end(), pair_cmp);
+  // policies that need arguments (an io
+  // device selector, a core load) get 'args'
+  template< typename... PolicyArgs >
+  SubmodularScheduler(
+    const SubmodularSchedulerOptions& options,
+    const PolicyArgs&... args)
+    : IndexSetPolicy(args...),
+      mode(options.mode),
+      epsilon(options.epsilon),
+      engine(options.seed),
+      fbest(0.0),
+      matrix(NULL),
+      nevals(0) {
+  }
 
-  std::set<int> vstarset;
-  vstarset.insert(vstar->first);
+  // place with a similarity matrix built once for
+  // the topology (TopologySnapshot::similarity)
+  // instead of one from the policy; it has to
+  // outlive the scheduler's placements
+  void useSimilarity(const SimilarityMatrix& shared) {
+    matrix = &shared;
+  }
 
-  std::vector< std::pair< std::set<int>, float> > fin;
-  fin.push_back( std::make_pair(vstarset, f(weights, vstarset)) );
-  fin.push_back( std::make_pair(G, f(weights, G)) );
+  // number of f evaluations used
+  // by the last placement
+  unsigned long evaluations() const {
+    return nevals;
+  }
 
-  std::vector< std::pair< std::set<int>, float> >::iterator finG =
-    std::max_element(fin.begin(), fin.end(), fin_cmp);
+  // f of the last placement
+  float value() const {
+    return fbest;
+  }
 
-  Gf = finG->first;
-}
+  void operator()(
+    CoreMask& Gf,
+    const float budget,
+    const float r = 1.0) {
+
+    const std::vector<int> nCores = getItems();
+
+    nevals = 0;
+
+    // cost is the number of
+    // tasks per core / total
+    // tasks on cpu
+    //
+    const std::valarray<float> cost =
+      getCostVector();
+
+    // num tasks per core weighted by num processing 
+    // units (physical threads) per core
+    //
+    const std::valarray<float> weights =
+      getWeightVector();
+
+    CoreMask items;
+    for(int i = 0; i < nCores.size(); i++) {
+      items.insert(nCores[i]);
+    }
+
+    // per-core coverage of G, each
+    // candidate gain is one O(n) pass
+    //
+    if(matrix == NULL || matrix->size() != static_cast<int>(cost.size())) {
+      if(similarity.size() != static_cast<int>(cost.size())) {
+        similarity.build(cost.size(), static_cast<IndexSetPolicy&>(*this));
+      }
+
+      matrix = &similarity;
+    }
+
+    fbest = place(items, cost, weights, Gf, budget, r);
+
+    // keep a placement of the same size inside one
+    // cache/die/numa domain, finest level first, when
+    // a domain has room for it; among the domains of
+    // a level the best value per cost wins
+    //
+    const int need = Gf.size();
+    bool placed = false;
+    float fplaced = 0.0;
+    float bestratio = 0.0;
+    CoreMask Gd;
+
+    foreach(const std::vector<CoreMask>& level, getDomains()) {
+      foreach(const CoreMask& domain, level) {
+        const CoreMask D = domain & items;
+        if(D.size() < need || D == items) {
+          continue;
+        }
+
+        CoreMask G;
+        const float fv = place(D, cost, weights, G, budget, r);
+        if(G.size() < need) {
+          continue;
+        }
+
+        float costG = 0.0;
+        foreach(int g, G) {
+          costG += cost[g];
+        }
+
+        const float ratio = fv / std::pow(std::max(costG, 1e-6f), r);
+        if(!placed || ratio > bestratio) {
+          Gd = G;
+          fplaced = fv;
+          bestratio = ratio;
+          placed = true;
+        }
+      }
+
+      if(placed) {
+        Gf = Gd;
+        fbest = fplaced;
+        return;
+      }
+    }
+  }
 
 };
 
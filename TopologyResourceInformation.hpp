@@ -23,6 +23,12 @@
 #include <valarray>
 #include <vector>
 #include <map>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <glog/logging.h>
 
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
@@ -31,9 +37,11 @@
 
 #include <stout/try.hpp>
 #include <stout/option.hpp>
+#include <stout/foreach.hpp>
 
 #include "cgroupcpusets.hpp"
 #include "HwlocTopology.hpp"
+#include "CoreOccupancy.hpp"
 
 using namespace std;
 using namespace process;
@@ -48,7 +56,8 @@ public:
   // detects hwloc support
   // finds all relevant devices
   // system components
-  TopologyResourceInformationProcess() {
+  TopologyResourceInformationProcess()
+    : topology(HwlocTopology::shared()) {
     Try<std::vector<std::string> > cpuset_groups = get_cpuset_groups();
 
     if(!cpuset_groups.isError()) {
@@ -71,77 +80,52 @@ public:
   // hwloc found, filtered by what cgroups has
   //
   process::Future<int> nSockets() {
-    return topology.nSockets().get();
+    return HwlocTopology::snapshot()->nSockets();
   }
 
   // get the number of cores
   // hwloc found
   process::Future<int> nCores() {
-    return topology.nCores().get();
+    return HwlocTopology::snapshot()->nCores();
   }
 
   // get the number of processing
   // units hwloc found
   process::Future<int> nProcessingUnits() {
-    return topology.nProcessingUnits().get();
+    return HwlocTopology::snapshot()->nProcessingUnits();
   }
 
   // get a list of # cores
   // per socket
   process::Future<std::vector<int>> nCoresPerSocket() {
-    return topology.nCoresPerSocket().get();
+    return topology.nCoresPerSocket();
   }
 
   // get the number of tasks
   // assigned to cores 
   //
   process::Future<std::map<int, int> > getTaskCount() {
-    // add support for getting all cpus
-    //
-    Try<std::map<int,int> > cpuset_cpu_util = get_cpuset_cpu_utilization(cpusetGroups);
-    /* if(cpuset_cpu_util.isError()) {
-      return Error("get cpuset utility map failed");
-    } */
-
-    return cpuset_cpu_util.get();
+    return taskCount();
   }
 
   // get normalized frequency
   // of "work" per core
   //
   process::Future<std::valarray<float> > getTaskFrequencyVector() {
-    std::valarray<float> costVec;
-
-    Future<std::map<int, int> > fcpu_util_mat = getTaskCount();
-    std::map<int, int> cpu_util_mat = fcpu_util_mat.get();
-
-    costVec.resize(cpu_util_mat.size());
-
-    std::for_each(
-      std::begin(cpu_util_mat), 
-      std::end(cpu_util_mat),
-
-      [&costVec, &cpu_util_mat] (std::pair<int, int> cpu) {
-        costVec[cpu.first] = static_cast<float>(cpu.second);
-    });
-
-    return costVec;
+    return tasksPerCore(taskCount());
   }
 
   // get task weights - #tasks-on-a-core / #core-processing-units
   //
   process::Future<std::valarray<float> > getWeightedTaskFrequencyVector() {
-    std::valarray<float> weightVec;
-
-    Future<std::map<int, int> > fcpu_util_mat = getTaskCount();
-    Future<std::vector<int> > fpu_per_core = topology.nProcessUnitsPerCore();
-
-    weightVec.resize(fcpu_util_mat.get().size());  
+    const std::shared_ptr<const TopologySnapshot> pinned = HwlocTopology::snapshot();
+    const TopologySnapshot& snapshot = *pinned;
+    std::valarray<float> weightVec = tasksPerCore(taskCount());
 
-    std::for_each(std::begin(fcpu_util_mat.get()), std::end(fcpu_util_mat.get()),
-      [&weightVec, &fpu_per_core] (std::pair<int, int> cpu) {
-      weightVec = static_cast<float>(cpu.second) / static_cast<float>(fpu_per_core.get()[cpu.first]);
-    });
+    for(int core = 0; core < snapshot.nCores(); core++) {
+      weightVec[core] = std::isfinite(weightVec[core]) ?
+        weightVec[core] / static_cast<float>(snapshot.pusPerCore[core]) : 0.0;
+    }
 
     return weightVec;
   }
@@ -149,11 +133,11 @@ public:
   process::Future<float> getCoreDistance(
     const int i,
     const int j) {
-    return topology.getCoreDistance(i, j).get();
+    return HwlocTopology::snapshot()->getCoreDistance(i, j);
   }
 
   process::Future<int> getNumaForCore(const int core) {
-    return topology.getNumaForCore(core);
+    return HwlocTopology::snapshot()->getNumaForCore(core);
   }
 
   process::Future<std::vector<int> > getCudaCpus() {
@@ -162,7 +146,44 @@ public:
 
 private:
 
-  HwlocTopology topology;
+  // tasks per os cpu, empty when the scan fails
+  std::map<int, int> taskCount() {
+    Try<std::map<int,int> > cpuset_cpu_util = get_cpuset_cpu_utilization(cpusetGroups);
+    if(cpuset_cpu_util.isError()) {
+      LOG(WARNING) << cpuset_cpu_util.error();
+      return std::map<int, int>();
+    }
+
+    return cpuset_cpu_util.get();
+  }
+
+  // cgroups count tasks per os cpu number, the
+  // scheduler wants them per logical core. a group
+  // holding both hyperthreads of a core counts once.
+  // cores outside the agent's cpuset cost +inf
+  //
+  std::valarray<float> tasksPerCore(const std::map<int, int>& cpu_util) {
+    const std::shared_ptr<const TopologySnapshot> pinned = HwlocTopology::snapshot();
+    const TopologySnapshot& snapshot = *pinned;
+    std::valarray<float> tasks(
+      std::numeric_limits<float>::infinity(), snapshot.nCores());
+
+    for(std::map<int, int>::const_iterator cpu = cpu_util.begin();
+        cpu != cpu_util.end(); ++cpu) {
+      const int core = snapshot.getCoreForCpu(cpu->first);
+      if(core < 0) {
+        continue;
+      }
+
+      tasks[core] = std::isfinite(tasks[core]) ?
+        std::max(tasks[core], static_cast<float>(cpu->second)) :
+        static_cast<float>(cpu->second);
+    }
+
+    return tasks;
+  }
+
+  HwlocTopology& topology;
 
   std::vector<std::string> cpusetGroups;
   std::vector<int> cpusetCpus;
@@ -172,7 +193,10 @@ private:
 class TopologyResourceInformation {
 public:
 
-  TopologyResourceInformation() {}
+  TopologyResourceInformation()
+    : process(new TopologyResourceInformationProcess()) {
+    spawn(process.get());
+  }
 
   process::Future<int> nSockets() {
     return dispatch(process.get(),
@@ -230,43 +254,149 @@ private:
 
 struct CpuTopologyResourceInformationPolicy {
 
+  // cost and weights from one scan of the
+  // cpuset groups, no actor round-trips
+  CpuTopologyResourceInformationPolicy()
+    : load(NULL),
+      pinned(HwlocTopology::snapshot()),
+      snapshot(*pinned) {
+    scanned = scan_core_load(snapshot);
+  }
+
+  // cost and weights from the isolator's
+  // occupancy index, no cgroup scan
+  CpuTopologyResourceInformationPolicy(const CoreLoad& load_)
+    : load(&load_),
+      pinned(HwlocTopology::snapshot()),
+      snapshot(*pinned) {
+  }
+
   int getNumItems() {
-    return topology.nCores().get();
+    return snapshot.nCores();
   }
 
+  // logical cores with an online pu
   std::vector<int> getItems() {
     std::vector<int> cpus;
-    for(int i = 0; i < getNumItems(); i++) {
-      cpus.push_back(i);
+    foreach(const int core, snapshot.onlineCores) {
+      cpus.push_back(core);
     }
 
     return cpus;
   }
 
-  int getSimilarity(const int i, const int j) {
-    return topology.getCoreDistance(i, j).get();
+  // nearby cores are similar, distant ones are not
+  float getSimilarity(const int i, const int j) {
+    return snapshot.getSimilarity(i, j);
+  }
+
+  // l3 first, then die, numa and socket
+  std::vector< std::vector<CoreMask> > getDomains() {
+    return snapshot.domains;
   }
 
   std::valarray<float> getCostVector() {
-    return topology.getTaskFrequencyVector().get();
+    return (load != NULL) ? load->cost : scanned.cost;
   }
 
   std::valarray<float> getWeightVector() {
-    return topology.getWeightedTaskFrequencyVector().get();
+    return (load != NULL) ? load->weights : scanned.weights;
   }
 
-  TopologyResourceInformation topology;
+  // the cgroup scan, only without a load
+  CoreLoad scanned;
+
+  const CoreLoad* load;
+
+  // read directly, no actor round-trips; held
+  // while the policy places on it
+  const std::shared_ptr<const TopologySnapshot> pinned;
+  const TopologySnapshot& snapshot;
+
+};
+
+// cores near a nic, nvme drive or accelerator
+// first. the selector is matched against the
+// snapshot's devices (see findIoDevices); the
+// cache/numa domains restricted to the device's
+// local cores come first, then the local cores
+// as a whole, then the machine wide domains when
+// the device's node is too full.
+//
+struct IoTopologyResourceInformationPolicy : public CpuTopologyResourceInformationPolicy {
+
+  IoTopologyResourceInformationPolicy(
+    const std::string& selector,
+    const CoreLoad& load)
+    : CpuTopologyResourceInformationPolicy(load) {
+    foreach(const int device, snapshot.findIoDevices(selector)) {
+      local |= snapshot.devices[device].cores;
+    }
+  }
+
+  // devices already chosen, the gpus of a
+  // joint gpu + core placement
+  IoTopologyResourceInformationPolicy(
+    const std::vector<int>& devices,
+    const CoreLoad& load)
+    : CpuTopologyResourceInformationPolicy(load) {
+    foreach(const int device, devices) {
+      local |= snapshot.devices[device].cores;
+    }
+  }
+
+  std::vector< std::vector<CoreMask> > getDomains() {
+    std::vector< std::vector<CoreMask> > domains;
+
+    if(local.empty()) {
+      return snapshot.domains;
+    }
+
+    foreach(const std::vector<CoreMask>& level, snapshot.domains) {
+      std::vector<CoreMask> near;
+      foreach(const CoreMask& domain, level) {
+        const CoreMask D = domain & local;
+        if(!D.empty()) {
+          near.push_back(D);
+        }
+      }
+
+      domains.push_back(near);
+    }
+
+    domains.push_back(std::vector<CoreMask>(1, local));
+    domains.insert(domains.end(), snapshot.domains.begin(), snapshot.domains.end());
+
+    return domains;
+  }
+
+  // cores local to any matching device
+  CoreMask local;
 
 };
 
 struct CudaTopologyResourceInformationPolicy : public CpuTopologyResourceInformationPolicy {
  
+  // cores local to the snapshot's gpus
   std::vector<int> getCudaCpus() {
-    return topology.getCudaCpus().get();
+    CoreMask local;
+    foreach(const IoDevice& device, snapshot.devices) {
+      if(device.kind == IO_GPU) {
+        local |= device.cores;
+      }
+    }
+
+    std::vector<int> cpus;
+    foreach(const int core, local) {
+      cpus.push_back(core);
+    }
+
+    return cpus;
   }
 
   std::valarray<float> getCudaCpusWeightVector() {
-    const std::valarray<float> cpuweights = getWeightVector();
+    const std::valarray<float> cpuweights =
+      CpuTopologyResourceInformationPolicy::getWeightVector();
     const std::vector<int> cudacpus = getCudaCpus();
 
     std::valarray<float> cudacpuweights;
@@ -0,0 +1,231 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  ct.clmsn
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <stout/foreach.hpp>
+
+#include "TopologySnapshot.hpp"
+
+// swapped with std::atomic_store, read with
+// std::atomic_load; an old snapshot goes with
+// its last reader. never destroyed, actors may
+// still read it while the process exits
+static std::shared_ptr<const TopologySnapshot>* current =
+  new std::shared_ptr<const TopologySnapshot>();
+
+// publishers take the generation in turn
+static std::mutex publish_mutex;
+
+std::shared_ptr<const TopologySnapshot> topology_snapshot() {
+  return std::atomic_load_explicit(current, std::memory_order_acquire);
+}
+
+void publish_topology_snapshot(TopologySnapshot* snapshot) {
+  std::lock_guard<std::mutex> lock(publish_mutex);
+
+  const std::shared_ptr<const TopologySnapshot> prev = topology_snapshot();
+  snapshot->generation = prev ? prev->generation + 1 : 1;
+
+  std::atomic_store_explicit(current,
+    std::shared_ptr<const TopologySnapshot>(snapshot), std::memory_order_release);
+}
+
+void TopologySnapshot::buildDomains() {
+  const std::vector<int>* levels[] =
+    { &coreL2, &coreL3, &coreGroup, &coreNuma, &coreSocket };
+
+  domains.clear();
+
+  for(size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+    const std::vector<int>& ids = *levels[l];
+    std::map<int, CoreMask> byid;
+
+    for(int c = 0; c < ncores && c < static_cast<int>(ids.size()); c++) {
+      if(ids[c] >= 0) {
+        byid[ids[c]].insert(c);
+      }
+    }
+
+    // a single domain is the whole machine
+    if(byid.size() < 2) {
+      continue;
+    }
+
+    std::vector<CoreMask> level;
+    for(std::map<int, CoreMask>::const_iterator d = byid.begin(); d != byid.end(); ++d) {
+      level.push_back(d->second);
+    }
+
+    if(!domains.empty() && domains.back() == level) {
+      continue;
+    }
+
+    domains.push_back(level);
+  }
+}
+
+void TopologySnapshot::buildSimilarity() {
+  std::shared_ptr<SimilarityMatrix> matrix(new SimilarityMatrix());
+  matrix->build(ncores, *this);
+  similarity = matrix;
+}
+
+void TopologySnapshot::buildIndex() {
+  int maxcpu = -1;
+  for(int p = 0; p < npus; p++) {
+    maxcpu = std::max(maxcpu, puOsIndex[p]);
+  }
+
+  cpuCore.assign(maxcpu + 1, -1);
+  cpuPu.assign(maxcpu + 1, -1);
+
+  std::vector<int> count(ncores, 0);
+
+  for(int p = 0; p < npus; p++) {
+    cpuPu[puOsIndex[p]] = p;
+    cpuCore[puOsIndex[p]] = puCore[p];
+
+    if(puCore[p] >= 0) {
+      count[puCore[p]]++;
+    }
+  }
+
+  corePuOffset.assign(ncores + 1, 0);
+  for(int c = 0; c < ncores; c++) {
+    corePuOffset[c + 1] = corePuOffset[c] + count[c];
+  }
+
+  // logical pu order keeps siblings in order
+  corePuList.assign(corePuOffset[ncores], -1);
+  std::vector<int> next(corePuOffset.begin(), corePuOffset.end() - 1);
+
+  for(int p = 0; p < npus; p++) {
+    if(puCore[p] >= 0) {
+      corePuList[next[puCore[p]]++] = puOsIndex[p];
+    }
+  }
+
+  onlineCores.clear();
+  foreach(const int cpu, onlineCpus) {
+    const int core = getCoreForCpu(cpu);
+    if(core >= 0) {
+      onlineCores.insert(core);
+    }
+  }
+}
+
+CoreMask TopologySnapshot::getCpusForCores(const CoreMask& cores) const {
+  CoreMask cpus;
+
+  foreach(const int core, cores) {
+    if(core < 0 || core >= ncores) {
+      continue;
+    }
+
+    for(const int* cpu = corePusBegin(core); cpu != corePusEnd(core); ++cpu) {
+      if(onlineCpus.count(*cpu)) {
+        cpus.insert(*cpu);
+      }
+    }
+  }
+
+  return cpus;
+}
+
+CoreMask TopologySnapshot::getNumasForCores(const CoreMask& cores) const {
+  CoreMask numas;
+
+  foreach(const int core, cores) {
+    const int numa = getNumaForCore(core);
+    if(numa >= 0) {
+      numas.insert(numa);
+    }
+  }
+
+  return numas;
+}
+
+CoreMask TopologySnapshot::getCoresForCpus(const CoreMask& cpus) const {
+  CoreMask cores;
+
+  foreach(const int cpu, cpus) {
+    const int core = getCoreForCpu(cpu);
+    if(core >= 0) {
+      cores.insert(core);
+    }
+  }
+
+  return cores;
+}
+
+static bool parse_hex(const std::string& str, unsigned& value) {
+  if(str.empty()) {
+    return false;
+  }
+
+  char* end = NULL;
+  value = static_cast<unsigned>(std::strtoul(str.c_str(), &end, 16));
+  return *end == '\0';
+}
+
+std::vector<int> TopologySnapshot::findIoDevices(
+  const std::string& selector) const {
+  static const char* kinds[] = { "nic", "storage", "gpu", "accelerator" };
+
+  std::vector<int> found;
+
+  for(size_t d = 0; d < devices.size(); d++) {
+    const IoDevice& device = devices[d];
+    bool match = false;
+    unsigned value = 0;
+
+    if(selector.compare(0, 4, "pci:") == 0) {
+      match = (device.busid == selector.substr(4));
+    }
+    else if(selector.compare(0, 7, "vendor:") == 0) {
+      match = parse_hex(selector.substr(7), value) && device.vendor == value;
+    }
+    else if(selector.compare(0, 6, "class:") == 0) {
+      const std::string cls = selector.substr(6);
+      match = parse_hex(cls, value) &&
+        ((cls.size() <= 2) ? ((device.classId >> 8) == value) : (device.classId == value));
+    }
+    else {
+      for(int k = 0; k < IO_OTHER; k++) {
+        if(selector == kinds[k]) {
+          match = (device.kind == k);
+        }
+      }
+
+      match = match ||
+        (std::find(device.names.begin(), device.names.end(), selector) != device.names.end());
+    }
+
+    if(match) {
+      found.push_back(d);
+    }
+  }
+
+  return found;
+}
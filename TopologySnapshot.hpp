@@ -0,0 +1,256 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  immutable, flat copy of the hwloc topology
+//
+//  HwlocTopologyProcess builds a snapshot after
+//  discovery and publishes it through an atomic
+//  pointer. placement policies read the snapshot
+//  directly instead of dispatching to the topology
+//  actors, a query is an array lookup.
+//
+//  cores and pus are numbered by their hwloc logical
+//  index. a published snapshot is never modified or
+//  freed, a topology change publishes a new one.
+//
+//  cgroups and sysfs name pus by their os (cpu)
+//  number, which can have gaps for offline cpus. the
+//  dense tables below are indexed by cpu number, with
+//  -1 in the gaps, and translate between the two.
+//
+//  ct.clmsn
+//
+
+#ifndef __MESOSTOPOLOGYSNAPSHOT__
+#define __MESOSTOPOLOGYSNAPSHOT__ 1
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+
+#include "CoreMask.hpp"
+#include "SimilarityMatrix.hpp"
+
+enum IoDeviceKind {
+  IO_NIC,
+  IO_STORAGE,
+  IO_GPU,
+  IO_ACCELERATOR,
+  IO_OTHER
+};
+
+// a pci device (or an os device hwloc found
+// outside of the pci tree) and where it sits
+struct IoDevice {
+
+  IoDevice()
+    : kind(IO_OTHER), vendor(0), device(0), classId(0), numa(-1) {
+  }
+
+  IoDeviceKind kind;
+
+  // "0000:03:00.0", empty without pci
+  std::string busid;
+
+  unsigned vendor;
+  unsigned device;
+  unsigned classId;
+
+  // os device names, "eth0", "mlx5_0", "nvme0n1"
+  std::vector<std::string> names;
+
+  // logical cores local to the device
+  CoreMask cores;
+
+  // numa os index, -1 if not bound to one
+  int numa;
+
+  // pci bridges from the host bridge down,
+  // devices behind the same switch share a prefix
+  std::vector<int> pciPath;
+};
+
+struct TopologySnapshot {
+
+  TopologySnapshot()
+    : nsockets(0), ncores(0), npus(0), nnumas(0), distanceUnit(1.0), generation(0) {
+  }
+
+  int nSockets() const {
+    return nsockets;
+  }
+
+  int nCores() const {
+    return ncores;
+  }
+
+  int nProcessingUnits() const {
+    return npus;
+  }
+
+  int nNumaNodes() const {
+    return nnumas;
+  }
+
+  float getCoreDistance(const int i, const int j) const {
+    return distance[i * ncores + j];
+  }
+
+  // distance in units of distanceUnit
+  float getRelativeCoreDistance(const int i, const int j) const {
+    return distance[i * ncores + j] / distanceUnit;
+  }
+
+  // nearby cores are similar, distant ones are not
+  float getSimilarity(const int i, const int j) const {
+    return 1.0 / (1.0 + getRelativeCoreDistance(i, j));
+  }
+
+  int getNumaForCore(const int core) const {
+    return (core >= 0 && core < ncores) ? coreNuma[core] : -1;
+  }
+
+  int getSocketForCore(const int core) const {
+    return (core >= 0 && core < ncores) ? coreSocket[core] : -1;
+  }
+
+  int getL3ForCore(const int core) const {
+    return (core >= 0 && core < ncores) ? coreL3[core] : -1;
+  }
+
+  // logical core of an os cpu number, -1 if
+  // hwloc doesn't know the cpu
+  int getCoreForCpu(const int cpu) const {
+    return (cpu >= 0 && cpu < static_cast<int>(cpuCore.size())) ? cpuCore[cpu] : -1;
+  }
+
+  // logical pu of an os cpu number
+  int getPuForCpu(const int cpu) const {
+    return (cpu >= 0 && cpu < static_cast<int>(cpuPu.size())) ? cpuPu[cpu] : -1;
+  }
+
+  // os cpu numbers of a core's pus
+  const int* corePusBegin(const int core) const {
+    return corePuList.data() + corePuOffset[core];
+  }
+
+  const int* corePusEnd(const int core) const {
+    return corePuList.data() + corePuOffset[core + 1];
+  }
+
+  // os cpu numbers of every online pu of the
+  // cores, what cpuset.cpus expects
+  CoreMask getCpusForCores(const CoreMask& cores) const;
+
+  // numa os indices of the cores, what
+  // cpuset.mems expects
+  CoreMask getNumasForCores(const CoreMask& cores) const;
+
+  // cores of a set of os cpu numbers
+  CoreMask getCoresForCpus(const CoreMask& cpus) const;
+
+  // fill the cpu number tables, the per core pu
+  // lists and onlineCores from the per pu vectors
+  void buildIndex();
+
+  // indices into 'devices' matching a selector,
+  //
+  //   nic, storage, gpu, accelerator    by kind
+  //   pci:0000:03:00.0                  by bus id
+  //   vendor:8086                       by pci vendor
+  //   class:0200, class:02              by pci (base) class
+  //   eth0, nvme0n1                     by os device name
+  //
+  std::vector<int> findIoDevices(const std::string& selector) const;
+
+  // group the cores by l2, l3, die/group, numa
+  // node and socket into 'domains', levels that
+  // don't split the machine, or split it exactly
+  // like the level below, are left out
+  void buildDomains();
+
+  // the scheduler's core x core similarity,
+  // once the distances are in
+  void buildSimilarity();
+
+  int nsockets;
+  int ncores;
+  int npus;
+  int nnumas;
+
+  // per core, indexed by logical core
+  std::vector<int> coreOsIndex;
+  std::vector<int> coreSocket;
+  std::vector<int> coreNuma;
+  std::vector<int> coreL2;
+  std::vector<int> coreL3;
+  std::vector<int> coreGroup;
+  std::vector<int> pusPerCore;
+
+  // per pu, indexed by logical pu
+  std::vector<int> puOsIndex;
+  std::vector<int> puCore;
+
+  // indexed by os cpu number
+  std::vector<int> cpuCore;
+  std::vector<int> cpuPu;
+
+  // os cpu numbers of core c's pus are
+  // corePuList[corePuOffset[c], corePuOffset[c + 1])
+  std::vector<int> corePuOffset;
+  std::vector<int> corePuList;
+
+  // os cpu numbers online at discovery, and
+  // the cores with at least one of them
+  CoreMask onlineCpus;
+  CoreMask onlineCores;
+
+  // nics, storage, gpus and accelerators
+  std::vector<IoDevice> devices;
+
+  // cache/die/numa/socket domains, finest
+  // level first, each a partition of the cores
+  std::vector< std::vector<CoreMask> > domains;
+
+  // ncores x ncores, row major
+  std::vector<float> distance;
+
+  // getSimilarity of every pair of cores, built
+  // once per discovery and shared by the copies
+  // an online cpu change publishes
+  std::shared_ptr<const SimilarityMatrix> similarity;
+
+  // distance of the closest distinct cores,
+  // 1 for derived distances, nanoseconds
+  // for measured latencies
+  float distanceUnit;
+
+  // bumped on every publish
+  uint64_t generation;
+
+};
+
+// latest published snapshot, empty before the
+// first hwloc discovery completes. a reader keeps
+// the snapshot alive while it holds the pointer,
+// the last one to drop an old snapshot frees it
+std::shared_ptr<const TopologySnapshot> topology_snapshot();
+
+// publish a new snapshot, takes ownership
+void publish_topology_snapshot(TopologySnapshot* snapshot);
+
+#endif
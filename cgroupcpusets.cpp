@@ -17,37 +17,306 @@
 // ct-clmsn
 //
 #include "cgroupcpusets.hpp"
+#include "CpuList.hpp"
 
 #include <list>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
 
+#include <fcntl.h>
 #include <unistd.h>
 
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
+
+CpusetBackend::~CpusetBackend() {
+  if(rootDirFd >= 0) {
+    close(rootDirFd);
+  }
+}
+
+int CpusetBackend::rootFd() {
+  if(rootDirFd < 0) {
+    rootDirFd = open(rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+
+  return rootDirFd;
+}
+
+CpusetV1Backend::CpusetV1Backend(const std::string& root)
+  : CpusetBackend(root) {
+}
+
+std::string CpusetV1Backend::version() const {
+  return "v1";
+}
+
+std::string CpusetV1Backend::rootCpusFile() const {
+  return "cpuset.cpus";
+}
+
+std::string CpusetV1Backend::rootMemsFile() const {
+  return "cpuset.mems";
+}
+
+std::string CpusetV1Backend::effectiveCpusFile() const {
+  return "cpuset.effective_cpus";
+}
+
+std::string CpusetV1Backend::groupCpusFile() const {
+  return "cpuset.cpus";
+}
+
+// moves every thread of the pid, 'tasks' only the one
+std::string CpusetV1Backend::procsFile() const {
+  return "cgroup.procs";
+}
+
+Try<Nothing> CpusetV1Backend::prepare() {
+  return Nothing();
+}
+
+Try<Nothing> CpusetV1Backend::cpusWritten(const std::string& group) {
+  return Nothing();
+}
+
+bool CpusetV1Backend::partitioned() const {
+  return false;
+}
+
+CpusetV2Backend::CpusetV2Backend(const std::string& root, const bool isolated_)
+  : CpusetBackend(root),
+    isolated(isolated_) {
+}
+
+std::string CpusetV2Backend::version() const {
+  return "v2";
+}
+
+std::string CpusetV2Backend::rootCpusFile() const {
+  return "cpuset.cpus.effective";
+}
+
+std::string CpusetV2Backend::rootMemsFile() const {
+  return "cpuset.mems.effective";
+}
+
+std::string CpusetV2Backend::effectiveCpusFile() const {
+  return "cpuset.cpus.effective";
+}
+
+std::string CpusetV2Backend::groupCpusFile() const {
+  return "cpuset.cpus.effective";
+}
+
+std::string CpusetV2Backend::procsFile() const {
+  return "cgroup.procs";
+}
+
+// first word of a one line control file
+static std::string read_control_line(const std::string& path) {
+  std::ifstream controlfile(path);
+  std::string line;
+
+  if(controlfile.is_open()) {
+    std::getline(controlfile, line);
+  }
+
+  return line;
+}
+
+static bool has_controller(const std::string& path, const std::string& controller) {
+  std::istringstream controllers(read_control_line(path));
+  std::string name;
+
+  while(controllers >> name) {
+    if(name == controller) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// a group only gets cpuset files when its
+// parent enables the controller for it. a pid
+// has one v2 group for every controller, one
+// moved out of the group mesos or systemd put
+// it in leaves their limits behind; the root
+// has to be a subtree delegated to the agent,
+// never the hierarchy's top (it has no
+// cgroup.type) where those groups live
+Try<Nothing> CpusetV2Backend::prepare() {
+  if(!os::exists(path::join(rootPath, "cgroup.type"))) {
+    return Error(rootPath + " is the top of the cgroup v2 hierarchy,"
+                 " set 'cgrouproot' to a subtree delegated to the agent");
+  }
+
+  if(!has_controller(path::join(rootPath, "cgroup.controllers"), "cpuset")) {
+    return Error(rootPath + " does not offer the cpuset controller");
+  }
+
+  const std::string subtree = path::join(rootPath, "cgroup.subtree_control");
+  if(has_controller(subtree, "cpuset")) {
+    return Nothing();
+  }
+
+  std::ofstream subtreefile(subtree);
+  if(!subtreefile.is_open()) {
+    return Error("error opening " + subtree);
+  }
+
+  subtreefile << "+cpuset";
+  subtreefile.flush();
+
+  if(!subtreefile.good()) {
+    return Error("error enabling cpuset in " + subtree);
+  }
+
+  return Nothing();
+}
+
+// the kernel takes any partition request and
+// reports it 'invalid' when the cpus overlap a
+// sibling's or aren't the parent's to give
+Try<Nothing> CpusetV2Backend::cpusWritten(const std::string& group) {
+  if(!isolated) {
+    return Nothing();
+  }
+
+  const std::string partition = path::join(rootPath, group, "cpuset.cpus.partition");
+
+  std::ofstream partitionfile(partition);
+  if(!partitionfile.is_open()) {
+    return Error("error opening " + partition);
+  }
+
+  partitionfile << "isolated";
+  partitionfile.close();
+
+  const std::string state = read_control_line(partition);
+  if(state.find("invalid") != std::string::npos) {
+    LOG(WARNING) << group << " is not an isolated partition: " << state;
+  }
+
+  return Nothing();
+}
+
+bool CpusetV2Backend::partitioned() const {
+  return isolated;
+}
+
+static CpusetBackend* cpuset_backend_instance = NULL;
+
+static CpusetBackend* detect_cpuset_backend(const Option<std::string>& root) {
+  if(root.isSome()) {
+    if(os::exists(path::join(root.get(), "cgroup.controllers"))) {
+      return new CpusetV2Backend(root.get());
+    }
+    return new CpusetV1Backend(root.get());
+  }
+
+  if(os::exists("/sys/fs/cgroup/cpuset")) {
+    return new CpusetV1Backend();
+  }
+
+  if(os::exists("/sys/fs/cgroup/cgroup.controllers")) {
+    return new CpusetV2Backend();
+  }
+
+  // nothing mounted, fail on v1's paths as before
+  return new CpusetV1Backend();
+}
+
+Try<Nothing> select_cpuset_backend(const CpusetBackendOptions& options) {
+  CpusetBackend* backend = NULL;
+
+  if(options.version.isNone()) {
+    backend = detect_cpuset_backend(options.root);
+    if(options.isolated && backend->version() == "v2") {
+      const std::string root = backend->root();
+      delete backend;
+      backend = new CpusetV2Backend(root, true);
+    }
+  }
+  else if(options.version.get() == "v1") {
+    backend = options.root.isSome() ?
+      new CpusetV1Backend(options.root.get()) : new CpusetV1Backend();
+  }
+  else if(options.version.get() == "v2") {
+    backend = options.root.isSome() ?
+      new CpusetV2Backend(options.root.get(), options.isolated) :
+      new CpusetV2Backend("/sys/fs/cgroup", options.isolated);
+  }
+  else {
+    return Error("unknown cgroup version '" + options.version.get() + "'");
+  }
+
+  if(options.isolated && backend->version() != "v2") {
+    LOG(WARNING) << "isolated partitions need cgroup v2, ignored";
+  }
+
+  delete cpuset_backend_instance;
+  cpuset_backend_instance = backend;
+
+  if(os::exists(backend->root())) {
+    return backend->prepare();
+  }
+
+  return Nothing();
+}
+
+CpusetBackend& cpuset_backend() {
+  if(cpuset_backend_instance == NULL) {
+    cpuset_backend_instance = detect_cpuset_backend(None());
+    if(os::exists(cpuset_backend_instance->root())) {
+      Try<Nothing> prepared = cpuset_backend_instance->prepare();
+      if(prepared.isError()) {
+        LOG(WARNING) << prepared.error();
+      }
+    }
+  }
+
+  return *cpuset_backend_instance;
+}
+
 Try<Nothing> has_cgroup_cpuset_subsystem() {
-  const std::string cpuset_dir_path = "/sys/fs/cgroup/cpuset";
+  const std::string& cpuset_dir_path = cpuset_backend().root();
   if(!os::exists(cpuset_dir_path)) {
-    return Error("/sys/fs/cgroup/cpuset <cpuset cgroup subsystem> does not exist!");
+    return Error(cpuset_dir_path + " <cpuset cgroup subsystem> does not exist!");
   }
 
   return Nothing();
 }
 
+// a pooled group waiting for a container,
+// its cpus are nobody's
+static bool idle_pool_group(const std::string& group, const std::string& group_path) {
+  if(group.compare(0, CPUSET_POOL_PREFIX.size(), CPUSET_POOL_PREFIX) != 0) {
+    return false;
+  }
+
+  return read_control_line(path::join(group_path, "cgroup.procs")).empty();
+}
+
 int get_cpuset_groups(std::vector<std::string>& cpuset_groups) {
   Try<Nothing> found_cgroup_cpuset_subsystem = has_cgroup_cpuset_subsystem();
   if(found_cgroup_cpuset_subsystem.isError()) {
     return 0;
   }
 
-  const std::string cpuset_dir_path = "/sys/fs/cgroup/cpuset";
+  const std::string cpuset_dir_path = cpuset_backend().root();
   Try<std::list<std::string> > cpuset_dir_entries = os::ls(cpuset_dir_path);
 
   std::copy_if(std::begin(cpuset_dir_entries.get()), std::end(cpuset_dir_entries.get()), 
     std::back_inserter(cpuset_groups),
     [&cpuset_dir_path](std::string entry) {
       std::string entry_path = path::join(cpuset_dir_path, entry);
-      return (os::stat::isdir(entry_path) && !os::stat::islink(entry_path));
+      return (os::stat::isdir(entry_path) && !os::stat::islink(entry_path) &&
+              !idle_pool_group(entry, entry_path));
     });
 
   return 1;
@@ -57,75 +326,58 @@ Try<std::vector<std::string> > get_cpuset_groups() {
   std::vector<std::string> cpuset_groups;
 
   if(get_cpuset_groups(cpuset_groups) != 1) {
-    return Error("/sys/fs/cgroup/cpuset not found");
+    return Error(cpuset_backend().root() + " not found");
   }
 
   return cpuset_groups;
 }
 
+// cpu/node numbers in a cpuset file, ascending
 static inline int parse_os_index_file(
   const std::string& os_idx_file_path, 
   std::vector<int>& indices ) 
 {
-  std::string fline;
-  std::ifstream fileistr(os_idx_file_path);
+  Try<CoreMask> mask = read_cpulist(os_idx_file_path.c_str());
+  if(mask.isError()) {
+    return -1;
+  }
 
-  // parsing code for the cpuset.cpus file...
-  // assumes structure found in testfile-testfile4
-  //
-  if(fileistr.is_open()) {
-    std::getline(fileistr, fline);
-    const size_t endpos = fline.find_last_not_of(" \t\n");
-    if( std::string::npos != endpos ) {
-      fline = fline.substr( 0, endpos+1 );
-    }
+  foreach(const int idx, mask.get()) {
+    indices.push_back(idx);
+  }
 
-    if(fline.find(",") != std::string::npos) {
-      std::istringstream lin(fline);
-      std::string procstr;
-
-      while(std::getline(lin, procstr, ',')) {
-
-        if(procstr.find("-") != std::string::npos) {
-
-          std::istringstream procstrm(procstr);
-          std::string proctok;
-          while(std::getline(procstrm, proctok, '-')) {
-            indices.push_back(std::stoi(proctok));
-          }
-
-          int i = *std::prev(std::end(indices));
-          int j = *std::end(indices);
-          for(int ii = i; ii < j; ii++) {
-            indices.push_back(ii);
-          }
-        }
-        else {
-          indices.push_back(std::stoi(procstr));
-        }
-      }
-    }
-    else if(fline.find("-") != std::string::npos) {
-      std::istringstream procstrm(fline);
-      std::string proctok;
-      while(std::getline(procstrm, proctok, '-')) {
-        indices.push_back(std::stoi(proctok));
-      }
+  return 1;
+}
 
-      int i = *std::prev(std::end(indices));
-      int j = *std::end(indices);
-      for(int ii = i; ii < j; ii++) {
-        indices.push_back(ii);
-      }
-    }
-    else {
-      indices.push_back(std::stoi(fline));
+// a valid isolated partition's cpus leave its
+// parent's cpuset.cpus.effective
+CoreMask get_cpuset_partition_cpus() {
+  CoreMask cpus;
+
+  const CpusetBackend& backend = cpuset_backend();
+  if(!backend.partitioned()) {
+    return cpus;
+  }
+
+  Try<std::list<std::string> > entries = os::ls(backend.root());
+  if(entries.isError()) {
+    return cpus;
+  }
+
+  foreach(const std::string& entry, entries.get()) {
+    const std::string group_path = path::join(backend.root(), entry);
+    if(read_control_line(path::join(group_path, "cpuset.cpus.partition")) != "isolated") {
+      continue;
     }
 
-    fileistr.close();
+    Try<CoreMask> partition = read_cpulist(
+      path::join(group_path, backend.groupCpusFile()).c_str());
+    if(partition.isSome()) {
+      cpus |= partition.get();
+    }
   }
 
-  return 1;
+  return cpus;
 }
 
 int get_cpuset_cpus(std::vector<int>& cpus) {
@@ -135,9 +387,18 @@ int get_cpuset_cpus(std::vector<int>& cpus) {
     return 0;
   }
 
-  //const std::string cpuset_dir_path = "testfile"; //path::join("/sys/fs/cgroup/cpuset/", "cpuset.cpus");
-  const std::string cpuset_dir_path = path::join("/sys/fs/cgroup/cpuset/", "cpuset.cpus");
-  return parse_os_index_file(cpuset_dir_path, cpus);
+  const CpusetBackend& backend = cpuset_backend();
+  Try<CoreMask> root = read_cpulist(
+    path::join(backend.root(), backend.rootCpusFile()).c_str());
+  if(root.isError()) {
+    return -1;
+  }
+
+  foreach(const int cpu, root.get() | get_cpuset_partition_cpus()) {
+    cpus.push_back(cpu);
+  }
+
+  return 1;
 }
 
 Try<std::vector<int> > get_cpuset_cpus() {
@@ -157,14 +418,15 @@ int get_cpuset_mems(std::vector<int>& mems) {
     return 0;
   }
 
-  const std::string mems_dir_path = path::join("/sys/fs/cgroup/cpuset/", "cpuset.mems");
+  const CpusetBackend& backend = cpuset_backend();
+  const std::string mems_dir_path = path::join(backend.root(), backend.rootMemsFile());
   return parse_os_index_file(mems_dir_path, mems);
 }
 
 Try<std::vector<int> > get_cpuset_mems() {
   std::vector<int> cpuset_mems;
-  if(get_cpuset_cpus(cpuset_mems) != 1) {
-    return Error("cpuset cpus not found");
+  if(get_cpuset_mems(cpuset_mems) != 1) {
+    return Error("cpuset mems not found");
   }
 
   std::sort(std::begin(cpuset_mems), std::end(cpuset_mems));
@@ -177,7 +439,7 @@ Try<Nothing> create_cpuset_group(const std::string& group) {
     return found_cgroup_cpuset_subsystem;
   }
 
-  if(os::mkdir(path::join("/sys/fs/cgroup/cpuset/", group)).isError()) {
+  if(os::mkdir(path::join(cpuset_backend().root(), group)).isError()) {
     return Error("mkdir failed!");
   }
 
@@ -190,32 +452,32 @@ Try<Nothing> destroy_cpuset_group(const std::string& group) {
     return found_cgroup_cpuset_subsystem;
   }
 
-  const std::string cpuset_dir_path = path::join("/sys/fs/cgroup/cpuset/", group);
+  const std::string cpuset_dir_path = path::join(cpuset_backend().root(), group);
   if(!os::exists(cpuset_dir_path)) {
     std::stringstream errorstrm;
-    errorstrm << "/sys/fs/cgroup/cpuset/" << group <<" does not exist!";
+    errorstrm << cpuset_dir_path <<" does not exist!";
     return Error(errorstrm.str());
   }
 
   if(os::rmdir(cpuset_dir_path).isError()) {
-    return Error("mkdir failed!");
+    return Error("rmdir failed!");
   }
 
   return Nothing();
 }
 
 Try<Nothing> attach_cpuset_group_pid(const std::string& group, const pid_t pid) {
-  const std::string cpuset_dir_path = path::join("/sys/fs/cgroup/cpuset/", group);
+  const std::string cpuset_dir_path = path::join(cpuset_backend().root(), group);
   if(!os::exists(cpuset_dir_path)) {
     std::stringstream errorstrm;
-    errorstrm << "/sys/fs/cgroup/cpuset/" << group <<" does not exist!";
+    errorstrm << cpuset_dir_path <<" does not exist!";
     return Error(errorstrm.str());
   }
 
   std::stringstream cpus_str_strm;
   cpus_str_strm << pid;
 
-  std::ofstream cpufile(path::join(cpuset_dir_path, "tasks"));
+  std::ofstream cpufile(path::join(cpuset_dir_path, cpuset_backend().procsFile()));
 
   if(cpufile.is_open()) {
     cpufile << cpus_str_strm.str();
@@ -223,103 +485,108 @@ Try<Nothing> attach_cpuset_group_pid(const std::string& group, const pid_t pid)
     cpufile.close();
   }
   else {
-    return Error("error opening tasks");
+    return Error("error opening " + cpuset_backend().procsFile());
   }
 
   return Nothing();
 }
 
-Try<Nothing> assign_cpuset_group_cpus(const std::string& group, const std::vector<int> cpus) {
-  const std::string cpuset_dir_path = path::join("/sys/fs/cgroup/cpuset/", group);
+Try<Nothing> assign_cpuset_group_cpus(const std::string& group, const CoreMask& cpus) {
+  const std::string cpuset_dir_path = path::join(cpuset_backend().root(), group);
   if(!os::exists(cpuset_dir_path)) {
     std::stringstream errorstrm; 
-    errorstrm << "/sys/fs/cgroup/cpuset/" << group << " does not exist!";
+    errorstrm << cpuset_dir_path << " does not exist!";
     return Error(errorstrm.str());
   }
 
-  std::stringstream cpus_str_strm;
-
-  if(cpus.size() > 1) {
-    std::for_each(std::begin(cpus), std::prev(std::end(cpus), 1), 
-      [&cpus_str_strm] (int cpu) {
-        cpus_str_strm << cpu << ",";
-    });
-
-    cpus_str_strm << (*std::end(cpus));
-  }
-  else {
-    cpus_str_strm << (*std::begin(cpus));
+  Try<Nothing> written = write_cpulist(path::join(cpuset_dir_path, "cpuset.cpus").c_str(), cpus);
+  if(written.isError()) {
+    return written;
   }
 
-  std::ofstream cpufile(path::join(cpuset_dir_path, "cpuset.cpus"));
-  if(cpufile.is_open()) {
-    cpufile << cpus_str_strm.str();
-    cpufile.close();
-  }
-  else {
-    return Error("error opening cpuset.cpus");
-  }
-
-  return Nothing();
+  return cpuset_backend().cpusWritten(group);
 }
 
 Try<Nothing> assign_cpuset_group_mems(
   const std::string& group, 
-  const std::vector<int> mems)
+  const CoreMask& mems)
 {
-  const std::string cpuset_dir_path = path::join("/sys/fs/cgroup/cpuset/", group);
+  const std::string cpuset_dir_path = path::join(cpuset_backend().root(), group);
 
   if(!os::exists(cpuset_dir_path)) {
     std::stringstream errorstrm;
-    errorstrm << "/sys/fs/cgroup/cpuset/" << group << " does not exist!";
+    errorstrm << cpuset_dir_path << " does not exist!";
     return Error(errorstrm.str());
   }
 
-  std::stringstream cpus_str_strm;
+  return write_cpulist(path::join(cpuset_dir_path, "cpuset.mems").c_str(), mems);
+}
 
-  if(mems.size() > 1) {
-    std::for_each(std::begin(mems), std::prev(std::end(mems), 1),
-      [&cpus_str_strm] (int cpu) {
-        cpus_str_strm << cpu << ",";
-    });
+Try<CoreMask> get_cpuset_group_cpus(const std::string& group) {
+  const std::string cpuset_cpus_path =
+    path::join(cpuset_backend().root(), group, cpuset_backend().groupCpusFile());
 
-    cpus_str_strm << (*std::end(mems));
-  }
-  else {
-    cpus_str_strm << (*std::begin(mems));
+  return read_cpulist(cpuset_cpus_path.c_str());
+}
+
+// "3:cpuset:/group" on v1, "0::/group" on v2
+Try<std::string> get_pid_cpuset_group(const pid_t pid) {
+  const std::string proc_path = "/proc/" + stringify(pid) + "/cgroup";
+
+  const int fd = open(proc_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    return ErrnoError("failed to open " + proc_path);
   }
 
-  std::ofstream cpufile(path::join(cpuset_dir_path, "cpuset.mems"));
-  if(cpufile.is_open()) {
-    cpufile << cpus_str_strm.str();
-    cpufile.close();
+  char buf[4096];
+  const ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+
+  if(len < 0) {
+    return ErrnoError("failed to read " + proc_path);
   }
-  else {
-    return Error("error opening cpuset.mems");
+
+  const bool v2 = cpuset_backend().version() == "v2";
+
+  std::istringstream lines(std::string(buf, len));
+  std::string line;
+
+  while(std::getline(lines, line)) {
+    const size_t first = line.find(':');
+    const size_t second = (first == std::string::npos) ?
+      std::string::npos : line.find(':', first + 1);
+
+    if(second == std::string::npos) {
+      continue;
+    }
+
+    const std::string controllers = line.substr(first + 1, second - first - 1);
+    const bool match = v2 ?
+      (line.compare(0, first, "0") == 0 && controllers.empty()) :
+      (("," + controllers + ",").find(",cpuset,") != std::string::npos);
+
+    if(match) {
+      const std::string group = line.substr(second + 1);
+      return (group.size() > 1) ? group.substr(1) : std::string();
+    }
   }
 
-  return Nothing();
+  return Error(proc_path + " has no cpuset hierarchy");
 }
 
 int _get_cpuset_cpu_utilization(
   const std::string& cpuset_path_str,
   std::map<int, int>& cpuset_utilization )
 {
-  std::vector<int> cpus;
-
-  if(parse_os_index_file( cpuset_path_str , cpus ) != -1 ) {
-    std::for_each(
-      std::begin(cpus),
-      std::end(cpus),
-      [&cpuset_utilization] (int cpu) {
-        const int cpucount = cpuset_utilization.count(cpu);
-        cpuset_utilization[cpu] = cpucount ? (cpucount + 1) : 1;
-      });
-  }
-  else {
+  Try<CoreMask> cpus = read_cpulist(cpuset_path_str.c_str());
+  if(cpus.isError()) {
     return -1;
   }
 
+  foreach(const int cpu, cpus.get()) {
+    cpuset_utilization[cpu]++;
+  }
+
   return 1;
 }
 
@@ -327,13 +594,14 @@ int get_cpuset_cpu_utilization(
   const std::string& cpuset_group, 
   std::map<int, int>& cpuset_utilization )
 {
-  const std::string cpuset_dir_path = path::join("/sys/fs/cgroup/cpuset/", cpuset_group);
+  const std::string cpuset_dir_path = path::join(cpuset_backend().root(), cpuset_group);
 
   if(!os::exists(cpuset_dir_path)) {
     return -1;
   }
 
-  const std::string cpuset_cpus_path = path::join(cpuset_dir_path, "cpuset.cpus");
+  const std::string cpuset_cpus_path =
+    path::join(cpuset_dir_path, cpuset_backend().groupCpusFile());
 
   if(!os::exists(cpuset_cpus_path)) {
     return -1;
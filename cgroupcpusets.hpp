@@ -24,14 +24,145 @@
 #include <map>
 
 #include <stout/os.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
+#include "CoreMask.hpp"
+
+// where cpuset groups live and what their files
+// are called. cgroup v1 mounts a cpuset hierarchy,
+// cgroup v2 has the cpuset controller in the unified
+// hierarchy. groups are created directly under root.
+//
+class CpusetBackend {
+public:
+  explicit CpusetBackend(const std::string& root_)
+    : rootPath(root_),
+      rootDirFd(-1) {
+  }
+
+  virtual ~CpusetBackend();
+
+  virtual std::string version() const = 0;
+
+  const std::string& root() const {
+    return rootPath;
+  }
+
+  // the root directory, opened on first use,
+  // groups are opened relative to it
+  int rootFd();
+
+  // the cpus and mems the root hands out
+  virtual std::string rootCpusFile() const = 0;
+  virtual std::string rootMemsFile() const = 0;
+
+  // the root's cpus less offline cpus
+  virtual std::string effectiveCpusFile() const = 0;
+
+  // the cpus a group's tasks run on
+  virtual std::string groupCpusFile() const = 0;
+
+  // a pid written here moves into the group
+  virtual std::string procsFile() const = 0;
+
+  // ready the root for new groups
+  virtual Try<Nothing> prepare() = 0;
+
+  // after a group's cpuset.cpus was written
+  virtual Try<Nothing> cpusWritten(const std::string& group) = 0;
+
+  // groups hold their cpus exclusively, an
+  // idle group keeps them from the others
+  virtual bool partitioned() const = 0;
+
+protected:
+  const std::string rootPath;
+
+private:
+  CpusetBackend(const CpusetBackend&);
+  CpusetBackend& operator=(const CpusetBackend&);
+
+  int rootDirFd;
+};
+
+class CpusetV1Backend : public CpusetBackend {
+public:
+  explicit CpusetV1Backend(const std::string& root = "/sys/fs/cgroup/cpuset");
+
+  virtual std::string version() const;
+  virtual std::string rootCpusFile() const;
+  virtual std::string rootMemsFile() const;
+  virtual std::string effectiveCpusFile() const;
+  virtual std::string groupCpusFile() const;
+  virtual std::string procsFile() const;
+  virtual Try<Nothing> prepare();
+  virtual Try<Nothing> cpusWritten(const std::string& group);
+  virtual bool partitioned() const;
+};
+
+// 'isolated' makes each group an isolated
+// partition, its cpus leave the scheduler's
+// load balancing. siblings need exclusive cpus.
+// the root must be a delegated subtree, the
+// default only names the mount point
+class CpusetV2Backend : public CpusetBackend {
+public:
+  explicit CpusetV2Backend(
+    const std::string& root = "/sys/fs/cgroup",
+    const bool isolated = false);
+
+  virtual std::string version() const;
+  virtual std::string rootCpusFile() const;
+  virtual std::string rootMemsFile() const;
+  virtual std::string effectiveCpusFile() const;
+  virtual std::string groupCpusFile() const;
+  virtual std::string procsFile() const;
+  virtual Try<Nothing> prepare();
+  virtual Try<Nothing> cpusWritten(const std::string& group);
+  virtual bool partitioned() const;
+
+private:
+  const bool isolated;
+};
+
+// groups the isolator creates ahead of
+// containers are named <prefix><n>
+static const std::string CPUSET_POOL_PREFIX = "cpusetpool-";
+
+struct CpusetBackendOptions {
+  CpusetBackendOptions()
+    : isolated(false) {
+  }
+
+  // "v1" or "v2", detected when none
+  Option<std::string> version;
+
+  // the version's usual mount point when none
+  Option<std::string> root;
+
+  // v2 isolated partitions
+  bool isolated;
+};
+
+// choose the backend before any other cgroup
+// call, the first call otherwise detects one
+Try<Nothing> select_cpuset_backend(const CpusetBackendOptions& options);
+
+CpusetBackend& cpuset_backend();
+
 Try<Nothing> has_cgroup_cpuset_subsystem();
 
 Try<std::vector<std::string> > get_cpuset_groups();
 
+// the root's cpus, with those its groups' isolated
+// partitions took out of its effective cpus
 Try<std::vector<int> > get_cpuset_cpus();
 
+// cpus of the root's groups that are isolated
+// partitions, none on an unpartitioned backend
+CoreMask get_cpuset_partition_cpus();
+
 Try<std::vector<int> > get_cpuset_mems();
 
 Try<Nothing> create_cpuset_group(const std::string& group);
@@ -44,11 +175,19 @@ Try<Nothing> attach_cpuset_group_pid(
 
 Try<Nothing> assign_cpuset_group_cpus(
   const std::string& group, 
-  const std::vector<int> cpus );
+  const CoreMask& cpus );
 
 Try<Nothing> assign_cpuset_group_mems(
   const std::string& group, 
-  const std::vector<int> mems );
+  const CoreMask& mems );
+
+Try<CoreMask> get_cpuset_group_cpus(
+  const std::string& group );
+
+// the group 'pid' runs in, relative to the top
+// of the mounted hierarchy (not the backend's
+// root), empty for the top itself
+Try<std::string> get_pid_cpuset_group(const pid_t pid);
 
 Try<std::map<int, int> > get_cpuset_cpu_utilization(
   const std::vector<std::string>& cpuset_groups );
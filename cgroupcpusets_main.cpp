@@ -1,5 +1,7 @@
 #include "cgroupcpusets.hpp"
 
+#include <stout/foreach.hpp>
+
 int main(int argc, char** argv) {
   std::cout << "\ncpuset groups" << std::endl;
 
@@ -54,9 +56,13 @@ int main(int argc, char** argv) {
 
     Try<std::vector<int> > cpuset_mems = get_cpuset_mems();
 
+    CoreMask demo_cpus, demo_mems;
+    foreach(const int cpu, cpuset_cpus.get()) { demo_cpus.insert(cpu); }
+    foreach(const int mem, cpuset_mems.get()) { demo_mems.insert(mem); }
+
     create_cpuset_group("demo");
-    assign_cpuset_group_cpus("demo", cpuset_cpus.get());
-    assign_cpuset_group_mems("demo", cpuset_mems.get());
+    assign_cpuset_group_cpus("demo", demo_cpus);
+    assign_cpuset_group_mems("demo", demo_mems);
     attach_cpuset_group_pid("demo", chld_pid); 
     sleep(10);
 
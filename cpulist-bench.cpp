@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stout/foreach.hpp>
+
+#include "CpuList.hpp"
+
+// the ifstream/istringstream/stoi parser and the
+// one entry per cpu stringstream writer this
+// replaced, with the range expansion fixed
+//
+static void stream_parse(const std::string& line, std::vector<int>& indices) {
+  std::istringstream lin(line);
+  std::string procstr;
+
+  while(std::getline(lin, procstr, ',')) {
+    const size_t dash = procstr.find('-');
+    if(dash == std::string::npos) {
+      indices.push_back(std::stoi(procstr));
+      continue;
+    }
+
+    const int lo = std::stoi(procstr.substr(0, dash));
+    const int hi = std::stoi(procstr.substr(dash + 1));
+    for(int i = lo; i <= hi; i++) {
+      indices.push_back(i);
+    }
+  }
+}
+
+static std::string stream_format(const std::vector<int>& indices) {
+  std::stringstream strm;
+
+  for(size_t i = 0; i < indices.size(); i++) {
+    if(i > 0) {
+      strm << ",";
+    }
+
+    strm << indices[i];
+  }
+
+  return strm.str();
+}
+
+// parse + format of one list, in memory and
+// through a file, stream versus cpulist
+//
+static void bench(const char* name, const CoreMask& mask, const int reps) {
+  char buf[CPULIST_BUFSIZE];
+  const int len = format_cpulist(mask, buf, sizeof(buf));
+  const std::string line(buf, len);
+  const char* path = "/tmp/cpulist-bench.cpus";
+
+  {
+    std::ofstream file(path);
+    file << line << "\n";
+  }
+
+  size_t check = 0;
+
+  const auto sstart = std::chrono::steady_clock::now();
+  for(int r = 0; r < reps; r++) {
+    std::vector<int> indices;
+    stream_parse(line, indices);
+    check += stream_format(indices).size();
+  }
+  const auto send = std::chrono::steady_clock::now();
+
+  const auto cstart = std::chrono::steady_clock::now();
+  for(int r = 0; r < reps; r++) {
+    CoreMask parsed;
+    parse_cpulist(line.data(), line.size(), parsed);
+    check += format_cpulist(parsed, buf, sizeof(buf));
+  }
+  const auto cend = std::chrono::steady_clock::now();
+
+  const auto fsstart = std::chrono::steady_clock::now();
+  for(int r = 0; r < reps; r++) {
+    std::ifstream file(path);
+    std::string fline;
+    std::getline(file, fline);
+    std::vector<int> indices;
+    stream_parse(fline, indices);
+    check += indices.size();
+  }
+  const auto fsend = std::chrono::steady_clock::now();
+
+  const auto fcstart = std::chrono::steady_clock::now();
+  for(int r = 0; r < reps; r++) {
+    check += read_cpulist(path).get().size();
+  }
+  const auto fcend = std::chrono::steady_clock::now();
+
+  std::remove(path);
+
+  std::cout << name << "\t" << mask.size() << "\t" << line.size() << "\t"
+            << std::chrono::duration<double, std::micro>(send - sstart).count() / reps << "\t"
+            << std::chrono::duration<double, std::micro>(cend - cstart).count() / reps << "\t"
+            << std::chrono::duration<double, std::micro>(fsend - fsstart).count() / reps << "\t"
+            << std::chrono::duration<double, std::micro>(fcend - fcstart).count() / reps << "\t"
+            << ((check > 0) ? "" : "-") << std::endl;
+}
+
+int main(int argc, char** argv) {
+  const int reps = (argc > 1) ? std::stoi(argv[1]) : 2000;
+
+  CoreMask all, alternate, random, blocks;
+  std::mt19937 engine(5489u);
+
+  all.insert(0, CoreMask::CAPACITY - 1);
+
+  for(int cpu = 0; cpu < CoreMask::CAPACITY; cpu += 2) {
+    alternate.insert(cpu);
+  }
+
+  for(int cpu = 0; cpu < CoreMask::CAPACITY; cpu++) {
+    if(engine() & 1) {
+      random.insert(cpu);
+    }
+  }
+
+  // 32 cpu containers on every other block
+  for(int cpu = 0; cpu < CoreMask::CAPACITY; cpu += 64) {
+    blocks.insert(cpu, cpu + 31);
+  }
+
+  std::cout << "list\tcpus\tchars\tstream-us\tcpulist-us\tstream-file-us\tcpulist-file-us" << std::endl;
+
+  bench("0-4095", all, reps);
+  bench("blocks", blocks, reps);
+  bench("random", random, reps);
+  bench("alternate", alternate, reps);
+
+  return 0;
+}
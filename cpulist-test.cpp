@@ -0,0 +1,100 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "CpuList.hpp"
+
+// parses 'list', false when parse_cpulist
+// doesn't return 'valid'
+static bool parses(const std::string& list, const bool valid, CoreMask& mask) {
+  mask.clear();
+  const bool parsed = parse_cpulist(list.data(), list.size(), mask);
+
+  if(parsed != valid) {
+    std::cout << "\"" << list << "\" " << (parsed ? "parsed" : "rejected") << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static std::string format(const CoreMask& mask) {
+  char buf[CPULIST_BUFSIZE];
+  const int len = format_cpulist(mask, buf, sizeof(buf));
+  return (len < 0) ? std::string("<too long>") : std::string(buf, len);
+}
+
+// parse -> format gives the list back
+static bool roundtrip(const std::string& list) {
+  CoreMask mask;
+  if(!parses(list, true, mask)) {
+    return false;
+  }
+
+  const std::string formatted = format(mask);
+  if(formatted != list) {
+    std::cout << "\"" << list << "\" formatted as \"" << formatted << "\"" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char** argv) {
+  bool ok = true;
+  CoreMask mask;
+
+  // a whole range
+  ok = parses("0-63", true, mask) && ok;
+  if(mask.size() != 64 || mask.first() != 0 || !mask.count(63) || mask.count(64)) {
+    std::cout << "\"0-63\" has " << mask.size() << " cpus" << std::endl;
+    ok = false;
+  }
+
+  // an empty list is valid, as an empty
+  // cpuset.cpus reads
+  ok = parses("", true, mask) && ok;
+  ok = parses("\n", true, mask) && ok;
+  if(!mask.empty() || format(mask) != "") {
+    std::cout << "empty list has " << mask.size() << " cpus" << std::endl;
+    ok = false;
+  }
+
+  // kernel files end in a newline
+  ok = parses("0-3,8\n", true, mask) && ok;
+  if(mask.size() != 5 || !mask.count(8)) {
+    std::cout << "\"0-3,8\\n\" has " << mask.size() << " cpus" << std::endl;
+    ok = false;
+  }
+
+  // malformed
+  ok = parses("1,,2", false, mask) && ok;
+  ok = parses("3-1", false, mask) && ok;
+  ok = parses("1,", false, mask) && ok;
+  ok = parses(",1", false, mask) && ok;
+  ok = parses("1-", false, mask) && ok;
+  ok = parses("a", false, mask) && ok;
+
+  // CoreMask::CAPACITY is the first index out of range
+  ok = parses("4095", true, mask) && ok;
+  ok = parses("4096", false, mask) && ok;
+  ok = parses("0-4096", false, mask) && ok;
+  ok = parses("100000", false, mask) && ok;
+
+  ok = roundtrip("0") && ok;
+  ok = roundtrip("0-63") && ok;
+  ok = roundtrip("0-3,8,10-11") && ok;
+  ok = roundtrip("1,3,5,7") && ok;
+  ok = roundtrip("4095") && ok;
+  ok = roundtrip("0-4095") && ok;
+
+  // every other cpu is the longest list
+  CoreMask sparse;
+  for(int cpu = 0; cpu < CoreMask::CAPACITY; cpu += 2) {
+    sparse.insert(cpu);
+  }
+  ok = roundtrip(format(sparse)) && ok;
+
+  std::cout << (ok ? "ok" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
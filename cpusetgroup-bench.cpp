@@ -0,0 +1,231 @@
+#include <sys/ptrace.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
+
+#include "cgroupcpusets.hpp"
+#include "CpusetGroup.hpp"
+
+// one isolation: create the group, write cpus
+// and mems, attach a pid. the path/ofstream
+// functions against an open CpusetGroup, on a
+// cpuset root or a plain directory standing in
+// for one (control files are created there).
+//
+// run as root against a scratch cpuset root,
+//   ./cpusetgroup_bench /sys/fs/cgroup/cpuset 1000
+//
+
+static const char* CONTROL_FILES[] = { "cpuset.cpus", "cpuset.mems", "cgroup.procs" };
+
+// attached to every group
+static pid_t pid;
+
+static std::string groupName(const int g) {
+  return "cpusetgroup-bench-" + stringify(g);
+}
+
+// what the kernel does on mkdir
+static void makeGroups(const std::string& root, const int n) {
+  for(int g = 0; g < n; g++) {
+    const std::string dir = root + "/" + groupName(g);
+    mkdir(dir.c_str(), 0755);
+
+    foreach(const char* file, CONTROL_FILES) {
+      const std::string path = dir + "/" + file;
+      if(access(path.c_str(), F_OK) != 0) {
+        std::ofstream(path.c_str()).close();
+      }
+    }
+  }
+}
+
+// out of the last group, or it can't be removed
+static void detach(const std::string& root) {
+  std::ofstream procs((root + "/" + cpuset_backend().procsFile()).c_str());
+  procs << getpid() << std::endl;
+}
+
+static void removeGroups(const std::string& root, const int n) {
+  detach(root);
+
+  for(int g = 0; g < n; g++) {
+    const std::string dir = root + "/" + groupName(g);
+
+    struct stat st;
+    if(stat((dir + "/cpuset.cpus").c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      foreach(const char* file, CONTROL_FILES) {
+        unlink((dir + "/" + file).c_str());
+      }
+    }
+
+    rmdir(dir.c_str());
+  }
+}
+
+static void isolateByPath(const int n, const CoreMask& cpus, const CoreMask& mems) {
+  for(int g = 0; g < n; g++) {
+    create_cpuset_group(groupName(g));
+    assign_cpuset_group_cpus(groupName(g), cpus);
+    assign_cpuset_group_mems(groupName(g), mems);
+    attach_cpuset_group_pid(groupName(g), pid);
+  }
+}
+
+static void isolateByHandle(
+  std::vector<CpusetGroup>& groups,
+  const CoreMask& cpus,
+  const CoreMask& mems) {
+  for(size_t g = 0; g < groups.size(); g++) {
+    groups[g].open(groupName(g), CpusetGroup::CREATE);
+    groups[g].writeCpus(cpus);
+    groups[g].writeMems(mems);
+    groups[g].attach(pid);
+  }
+}
+
+// a re-placement, the groups are open
+static void replaceByHandle(
+  std::vector<CpusetGroup>& groups,
+  const CoreMask& cpus,
+  const CoreMask& mems) {
+  for(size_t g = 0; g < groups.size(); g++) {
+    groups[g].writeCpus(cpus);
+    groups[g].writeMems(mems);
+    groups[g].attach(pid);
+  }
+}
+
+static void run(const int variant, const int n, const CoreMask& cpus, const CoreMask& mems) {
+  pid = getpid();
+  std::vector<CpusetGroup> groups(n);
+
+  if(variant == 2) {
+    isolateByHandle(groups, cpus, mems);
+  }
+
+  raise(SIGSTOP);
+
+  switch(variant) {
+    case 0: isolateByPath(n, cpus, mems); break;
+    case 1: isolateByHandle(groups, cpus, mems); break;
+    case 2: replaceByHandle(groups, cpus, mems); break;
+  }
+
+  raise(SIGSTOP);
+}
+
+// syscalls made between the child's two SIGSTOPs
+static long countSyscalls(const int variant, const int n, const CoreMask& cpus, const CoreMask& mems) {
+  const pid_t child = fork();
+  if(child == 0) {
+    ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    run(variant, n, cpus, mems);
+    _exit(0);
+  }
+
+  int status;
+  long syscalls = 0;
+
+  // the first SIGSTOP
+  waitpid(child, &status, 0);
+  int stops = 1;
+  ptrace(PTRACE_SETOPTIONS, child, NULL, PTRACE_O_TRACESYSGOOD);
+
+  while(true) {
+    ptrace(PTRACE_SYSCALL, child, NULL, NULL);
+    if(waitpid(child, &status, 0) < 0 || WIFEXITED(status)) {
+      break;
+    }
+
+    if(WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      syscalls += (stops == 1);
+    }
+    else if(WSTOPSIG(status) == SIGSTOP) {
+      stops++;
+    }
+  }
+
+  // entry and exit stops
+  return syscalls / 2;
+}
+
+static double timeIsolations(const int variant, const int n, const CoreMask& cpus, const CoreMask& mems) {
+  std::vector<CpusetGroup> groups(n);
+
+  if(variant == 2) {
+    isolateByHandle(groups, cpus, mems);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  switch(variant) {
+    case 0: isolateByPath(n, cpus, mems); break;
+    case 1: isolateByHandle(groups, cpus, mems); break;
+    case 2: replaceByHandle(groups, cpus, mems); break;
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::micro>(end - start).count() / n;
+}
+
+int main(int argc, char** argv) {
+  const std::string root = (argc > 1) ? argv[1] : "/tmp/cpusetgroup-bench";
+  const int n = (argc > 2) ? std::stoi(argv[2]) : 1000;
+
+  mkdir(root.c_str(), 0755);
+  pid = getpid();
+
+  CpusetBackendOptions options;
+  options.root = root;
+  Try<Nothing> selected = select_cpuset_backend(options);
+  if(selected.isError()) {
+    std::cerr << selected.error() << std::endl;
+    return 1;
+  }
+
+  // the root's cpus and mems, or one cpu and
+  // node on a plain directory
+  CoreMask cpus, mems;
+
+  Try<std::vector<int> > rootCpus = get_cpuset_cpus();
+  Try<std::vector<int> > rootMems = get_cpuset_mems();
+
+  if(rootCpus.isSome() && rootMems.isSome()) {
+    foreach(const int cpu, rootCpus.get()) { cpus.insert(cpu); }
+    foreach(const int mem, rootMems.get()) { mems.insert(mem); }
+  }
+  else {
+    cpus.insert(0);
+    mems.insert(0);
+  }
+
+  const char* names[] = { "path", "handle", "handle-replace" };
+
+  std::cout << "backend " << cpuset_backend().version() << ", " << n << " groups" << std::endl;
+  std::cout << "isolation\tsyscalls\tus" << std::endl;
+
+  for(int variant = 0; variant < 3; variant++) {
+    makeGroups(root, n);
+    const long syscalls = countSyscalls(variant, n, cpus, mems);
+    const double us = timeIsolations(variant, n, cpus, mems);
+    removeGroups(root, n);
+
+    std::cout << names[variant] << "\t"
+              << static_cast<double>(syscalls) / n << "\t"
+              << us << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <cstdlib>
+#include <iostream>
+
+#include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
+
+#include "HwlocTopology.hpp"
+#include "GpuPlacement.hpp"
+
+// gpuplacement_main xml:topologies/gpu-2s4gpu.xml 2:8 1:4 2:8
+//
+// places one container per ngpus:ncores argument on
+// an idle machine, each keeps its gpus
+//
+int main(int argc, char** argv) {
+  if(argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " xml:<file>|synthetic:<desc> ngpus:ncores ..." << std::endl;
+    return 1;
+  }
+
+  HwlocTopologyOptions options;
+  Try<Nothing> source = parse_topology_source(argv[1], options);
+  if(source.isError()) {
+    std::cerr << source.error() << std::endl;
+    return 1;
+  }
+
+  const std::shared_ptr<const TopologySnapshot> pinned = HwlocTopology::shared(options).snapshot();
+  const TopologySnapshot& snapshot = *pinned;
+  const std::valarray<float> cost(0.0f, snapshot.nCores());
+  GpuOccupancy occupancy;
+
+  for(int a = 2; a < argc; a++) {
+    const std::string request(argv[a]);
+    const size_t colon = request.find(':');
+    const int ngpus = std::atoi(request.substr(0, colon).c_str());
+    const int ncores = (colon != std::string::npos) ?
+      std::atoi(request.substr(colon + 1).c_str()) : 1;
+
+    const std::string container = "container" + stringify(a - 1);
+    Try<GpuPlacement> placement =
+      select_gpus(snapshot, occupancy, ngpus, ncores, cost);
+
+    if(placement.isError()) {
+      std::cout << container << "\t" << placement.error() << std::endl;
+      continue;
+    }
+
+    std::cout << container << "\tscore " << placement.get().score;
+    foreach(const int gpu, placement.get().gpus) {
+      occupancy.hold(snapshot.devices[gpu].busid, container);
+      std::cout << "\t" << snapshot.devices[gpu].busid
+                << " (numa " << snapshot.devices[gpu].numa << ")";
+    }
+
+    std::cout << "\tlocal cores " << placement.get().local.size() << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <string>
+
+#include <mesos/mesos.hpp>
+
+#include <process/collect.hpp>
+#include <process/future.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
+
+#include "cgroupcpusets.hpp"
+#include "CpusetAssigner.hpp"
+#include "HwlocTopology.hpp"
+
+// isolate_bench <cpuset root> [containers] [ioworkers] [poolsize]
+//
+// places 1 core containers through the assigner
+// and attaches a sleeping child to each, first one
+// at a time (each isolate waits for the last) and
+// then all at once, as a launch burst would. run
+// as root against a scratch group of the cpuset
+// hierarchy, e.g. /sys/fs/cgroup/cpuset/bench.
+//
+
+static mesos::ContainerID containerId(const std::string& burst, const int c) {
+  mesos::ContainerID id;
+  id.set_value("isolate-bench-" + burst + "-" + stringify(c));
+  return id;
+}
+
+static void releaseAll(CpusetAssigner& assigner, const std::string& burst, const int n) {
+  std::list<process::Future<Nothing> > released;
+  for(int c = 0; c < n; c++) {
+    released.push_back(assigner.release(containerId(burst, c)));
+  }
+
+  process::collect(released).await();
+}
+
+int main(int argc, char** argv) {
+  if(argc < 2) {
+    std::cerr << "usage: " << argv[0]
+              << " <cpuset root> [containers] [ioworkers] [poolsize]" << std::endl;
+    return 1;
+  }
+
+  const int n = (argc > 2) ? std::stoi(argv[2]) : 200;
+  const size_t ioWorkers = (argc > 3) ? std::stoul(argv[3]) : 2;
+  const size_t poolSize = (argc > 4) ? std::stoul(argv[4]) : 0;
+
+  CpusetBackendOptions backendOptions;
+  backendOptions.root = std::string(argv[1]);
+  Try<Nothing> backend = select_cpuset_backend(backendOptions);
+  if(backend.isError()) {
+    std::cerr << backend.error() << std::endl;
+    return 1;
+  }
+
+  HwlocTopology::shared();
+
+  // moved from group to group, it has
+  // to be gone before they're removed
+  const pid_t child = fork();
+  if(child == 0) {
+    pause();
+    _exit(0);
+  }
+
+  CpusetAssigner assigner(SubmodularSchedulerOptions(), Seconds(0), poolSize, ioWorkers);
+
+  const auto sstart = std::chrono::steady_clock::now();
+  for(int c = 0; c < n; c++) {
+    assigner.assign(containerId("serial", c), child, 1.0, 0.0).await();
+  }
+  const auto send = std::chrono::steady_clock::now();
+
+  std::list<process::Future<bool> > assigned;
+  const auto pstart = std::chrono::steady_clock::now();
+  for(int c = 0; c < n; c++) {
+    assigned.push_back(assigner.assign(containerId("burst", c), child, 1.0, 0.0));
+  }
+  process::collect(assigned).await();
+  const auto pend = std::chrono::steady_clock::now();
+
+  int placed = 0;
+  foreach(const process::Future<bool>& future, assigned) {
+    placed += (future.isReady() && future.get()) ? 1 : 0;
+  }
+
+  kill(child, SIGKILL);
+  waitpid(child, NULL, 0);
+
+  releaseAll(assigner, "serial", n);
+  releaseAll(assigner, "burst", n);
+
+  const double serial = std::chrono::duration<double>(send - sstart).count();
+  const double burst = std::chrono::duration<double>(pend - pstart).count();
+
+  std::cout << "containers " << n << ", io workers " << ioWorkers
+            << ", pool " << poolSize << ", placed " << placed << std::endl;
+  std::cout << "one at a time\t" << n / serial << " isolations/s" << std::endl;
+  std::cout << "all at once\t" << n / burst << " isolations/s" << std::endl;
+
+  return 0;
+}
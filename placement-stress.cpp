@@ -0,0 +1,249 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include <process/collect.hpp>
+#include <process/future.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include "cgroupcpusets.hpp"
+#include "CpuList.hpp"
+#include "CpusetAssigner.hpp"
+#include "HwlocTopology.hpp"
+
+// placement_stress [containers] [placementworkers] [ioworkers] [cores]
+//
+// places 1 core containers, then containers of
+// 'cores' cores (4 by default, at most the
+// machine's), against a plain directory standing
+// in for the cpuset root, first one at a time and
+// then every isolate's assign at once. the burst
+// fails if a cpu ends up with more containers than
+// the busiest one of the serial run (placements
+// chosen on the same load booked it twice), a
+// container has no group or other than its number
+// of cores. needs no cgroups or root.
+//
+
+static mesos::ContainerID containerId(const std::string& run, const int c) {
+  mesos::ContainerID id;
+  id.set_value("placement-stress-" + run + "-" + stringify(c));
+  return id;
+}
+
+// containers on the busiest cpu, from the groups'
+// cpuset.cpus; -1 when one is missing or wrong
+static int busiest(
+  CpusetAssigner& assigner,
+  const TopologySnapshot& snapshot,
+  const std::string& run,
+  const int n,
+  const int ncores) {
+  std::vector<int> holders(CoreMask::CAPACITY, 0);
+
+  for(int c = 0; c < n; c++) {
+    process::Future<Option<CoreMask> > cpus = assigner.cpus(containerId(run, c)).await();
+    if(!cpus.isReady() || cpus.get().isNone()) {
+      std::cerr << containerId(run, c).value() << " has no group" << std::endl;
+      return -1;
+    }
+
+    const CoreMask& mask = cpus.get().get();
+    if(snapshot.getCoresForCpus(mask).size() != ncores) {
+      std::cerr << containerId(run, c).value() << " got "
+                << mask.size() << " cpus" << std::endl;
+      return -1;
+    }
+
+    foreach(const int cpu, mask) {
+      holders[cpu]++;
+    }
+  }
+
+  return *std::max_element(holders.begin(), holders.end());
+}
+
+static void releaseAll(CpusetAssigner& assigner, const std::string& run, const int n) {
+  std::list<process::Future<Nothing> > released;
+  for(int c = 0; c < n; c++) {
+    released.push_back(assigner.release(containerId(run, c)));
+  }
+
+  process::collect(released).await();
+}
+
+// cpuset.cpus/mems of the machine
+// at the top of the stand in
+static Try<std::string> fakeRoot() {
+  char dir[] = "/tmp/placement-stress.XXXXXX";
+  if(mkdtemp(dir) == NULL) {
+    return ErrnoError("mkdtemp");
+  }
+
+  Try<CoreMask> online = read_cpulist("/sys/devices/system/cpu/online");
+  if(online.isError()) {
+    return Error(online.error());
+  }
+
+  Try<CoreMask> nodes = read_cpulist("/sys/devices/system/node/online");
+  CoreMask mems;
+  if(nodes.isSome()) {
+    mems = nodes.get();
+  } else {
+    mems.insert(0);
+  }
+
+  const std::string root(dir);
+  const char* files[] = { "cpuset.cpus", "cpuset.effective_cpus", "cpuset.mems" };
+  for(size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++) {
+    const std::string file = path::join(root, files[f]);
+    if(!os::exists(file)) {
+      os::write(file, "");
+    }
+
+    Try<Nothing> written = write_cpulist(file.c_str(),
+      (std::string(files[f]) == "cpuset.mems") ? mems : online.get());
+    if(written.isError()) {
+      return Error(written.error());
+    }
+  }
+
+  return root;
+}
+
+// one serial run and one burst of n
+// containers of ncores cores each
+static bool stress(
+  CpusetAssigner& assigner,
+  const TopologySnapshot& snapshot,
+  const int n,
+  const int ncores) {
+  const std::string serialRun = "serial" + stringify(ncores);
+  const std::string burstRun = "burst" + stringify(ncores);
+
+  bool ok = true;
+
+  const auto sstart = std::chrono::steady_clock::now();
+  for(int c = 0; c < n; c++) {
+    process::Future<bool> assigned =
+      assigner.assign(containerId(serialRun, c), getpid(), ncores, 0.0).await();
+    if(!assigned.isReady() || !assigned.get()) {
+      std::cerr << containerId(serialRun, c).value() << " not placed" << std::endl;
+      ok = false;
+    }
+  }
+  const auto send = std::chrono::steady_clock::now();
+
+  const int serialMost = busiest(assigner, snapshot, serialRun, n, ncores);
+  releaseAll(assigner, serialRun, n);
+
+  std::list<process::Future<bool> > assigned;
+  const auto bstart = std::chrono::steady_clock::now();
+  for(int c = 0; c < n; c++) {
+    assigned.push_back(assigner.assign(containerId(burstRun, c), getpid(), ncores, 0.0));
+  }
+  process::collect(assigned).await();
+  const auto bend = std::chrono::steady_clock::now();
+
+  int placed = 0;
+  foreach(const process::Future<bool>& future, assigned) {
+    placed += (future.isReady() && future.get()) ? 1 : 0;
+  }
+
+  if(placed != n) {
+    std::cerr << "placed " << placed << " of " << n << std::endl;
+    ok = false;
+  }
+
+  const int burstMost = busiest(assigner, snapshot, burstRun, n, ncores);
+  releaseAll(assigner, burstRun, n);
+
+  // n containers of ncores spread over the
+  // online cores leave none busier than this;
+  // a core double booked by the burst is
+  const int online = snapshot.onlineCores.size();
+  const int bound = (n * ncores + online - 1) / online;
+
+  if(serialMost < 0 || burstMost < 0) {
+    ok = false;
+  } else if(serialMost > bound || burstMost > bound) {
+    std::cerr << "a cpu holds " << std::max(serialMost, burstMost)
+              << " containers, at most " << bound << " fit" << std::endl;
+    ok = false;
+  }
+
+  const double serial = std::chrono::duration<double>(send - sstart).count();
+  const double burst = std::chrono::duration<double>(bend - bstart).count();
+
+  std::cout << ncores << " core containers" << std::endl;
+  std::cout << "one at a time\t" << n / serial << " isolations/s, at most "
+            << serialMost << " per cpu" << std::endl;
+  std::cout << "all at once\t" << n / burst << " isolations/s, at most "
+            << burstMost << " per cpu" << std::endl;
+
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  const int n = (argc > 1) ? std::stoi(argv[1]) : 1000;
+  const size_t placementWorkers = (argc > 2) ? std::stoul(argv[2]) : 4;
+  const size_t ioWorkers = (argc > 3) ? std::stoul(argv[3]) : 2;
+  const int cores = (argc > 4) ? std::stoi(argv[4]) : 4;
+
+  Try<std::string> root = fakeRoot();
+  if(root.isError()) {
+    std::cerr << root.error() << std::endl;
+    return 1;
+  }
+
+  CpusetBackendOptions backendOptions;
+  backendOptions.version = std::string("v1");
+  backendOptions.root = root.get();
+  Try<Nothing> backend = select_cpuset_backend(backendOptions);
+  if(backend.isError()) {
+    std::cerr << backend.error() << std::endl;
+    return 1;
+  }
+
+  HwlocTopology::shared();
+  const std::shared_ptr<const TopologySnapshot> pinned = HwlocTopology::snapshot();
+  const TopologySnapshot& snapshot = *pinned;
+
+  CpusetAssigner assigner(
+    SubmodularSchedulerOptions(), Seconds(0), 0, ioWorkers, placementWorkers);
+
+  std::cout << "containers " << n << ", cores " << snapshot.onlineCores.size()
+            << ", placement workers " << placementWorkers
+            << ", io workers " << ioWorkers << std::endl;
+
+  const int multi = std::min(cores, static_cast<int>(snapshot.onlineCores.size()));
+
+  bool ok = stress(assigner, snapshot, n, 1);
+  if(multi > 1) {
+    ok = stress(assigner, snapshot, n, multi) && ok;
+  }
+
+  Try<std::vector<std::string> > left = get_cpuset_groups();
+  if(left.isSome() && !left.get().empty()) {
+    std::cerr << left.get().size() << " groups left in " << root.get() << std::endl;
+    ok = false;
+  } else {
+    os::rmdir(root.get());
+  }
+
+  std::cout << (ok ? "ok" : "FAILED") << std::endl;
+
+  return ok ? 0 : 1;
+}
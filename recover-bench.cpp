@@ -0,0 +1,152 @@
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include <mesos/mesos.hpp>
+
+#include <process/collect.hpp>
+#include <process/future.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include "cgroupcpusets.hpp"
+#include "CpusetAssigner.hpp"
+#include "HwlocTopology.hpp"
+
+// recover_bench <cpuset root> [containers] [ioworkers] [poolsize]
+//
+// places 1 core containers with one assigner, drops
+// it as an agent restart would and times a second
+// assigner's recover() of the same containers. fails
+// if a recovered container's cpus differ from what it
+// was placed on or its group's cpuset.cpus was
+// written again. run as root against a scratch
+// group of the cpuset hierarchy.
+//
+
+static mesos::ContainerID containerId(const int c) {
+  mesos::ContainerID id;
+  id.set_value("recover-bench-" + stringify(c));
+  return id;
+}
+
+// when a group's cpus were last written
+static Option<struct timespec> cpusWritten(const std::string& root, const std::string& group) {
+  struct stat st;
+  if(stat(path::join(root, group, "cpuset.cpus").c_str(), &st) < 0) {
+    return None();
+  }
+
+  return st.st_mtim;
+}
+
+int main(int argc, char** argv) {
+  if(argc < 2) {
+    std::cerr << "usage: " << argv[0]
+              << " <cpuset root> [containers] [ioworkers] [poolsize]" << std::endl;
+    return 1;
+  }
+
+  const std::string root(argv[1]);
+  const int n = (argc > 2) ? std::stoi(argv[2]) : 500;
+  const size_t ioWorkers = (argc > 3) ? std::stoul(argv[3]) : 2;
+  const size_t poolSize = (argc > 4) ? std::stoul(argv[4]) : 0;
+
+  CpusetBackendOptions backendOptions;
+  backendOptions.root = root;
+  Try<Nothing> backend = select_cpuset_backend(backendOptions);
+  if(backend.isError()) {
+    std::cerr << backend.error() << std::endl;
+    return 1;
+  }
+
+  HwlocTopology::shared();
+
+  std::map<int, pid_t> children;
+  for(int c = 0; c < n; c++) {
+    const pid_t child = fork();
+    if(child == 0) {
+      pause();
+      _exit(0);
+    }
+    children[c] = child;
+  }
+
+  std::map<std::string, Option<CoreMask> > placed;
+  {
+    CpusetAssigner before(SubmodularSchedulerOptions(), Seconds(0), poolSize, ioWorkers);
+
+    std::list<process::Future<bool> > assigned;
+    for(int c = 0; c < n; c++) {
+      assigned.push_back(before.assign(containerId(c), children[c], 1.0, 0.0));
+    }
+    process::collect(assigned).await();
+
+    for(int c = 0; c < n; c++) {
+      placed[containerId(c).value()] = before.cpus(containerId(c)).await().get();
+    }
+  }
+
+  std::map<std::string, Option<struct timespec> > written;
+  std::map<std::string, pid_t> containers;
+  for(int c = 0; c < n; c++) {
+    written[containerId(c).value()] = cpusWritten(root, containerId(c).value());
+    containers[containerId(c).value()] = children[c];
+  }
+
+  CpusetAssigner after(SubmodularSchedulerOptions(), Seconds(0), poolSize, ioWorkers);
+
+  const auto start = std::chrono::steady_clock::now();
+  after.recover(containers, std::set<std::string>()).await();
+  const auto end = std::chrono::steady_clock::now();
+
+  bool ok = true;
+  for(int c = 0; c < n; c++) {
+    const std::string container = containerId(c).value();
+    const Option<CoreMask> cpus = after.cpus(containerId(c)).await().get();
+
+    if(cpus != placed[container]) {
+      std::cerr << container << " came back on other cpus" << std::endl;
+      ok = false;
+    }
+
+    const Option<struct timespec> now = cpusWritten(root, container);
+    if(now.isSome() && written[container].isSome() &&
+       (now.get().tv_sec != written[container].get().tv_sec ||
+        now.get().tv_nsec != written[container].get().tv_nsec)) {
+      std::cerr << container << " was placed again" << std::endl;
+      ok = false;
+    }
+  }
+
+  for(std::map<int, pid_t>::const_iterator child = children.begin();
+      child != children.end(); ++child) {
+    kill(child->second, SIGKILL);
+    waitpid(child->second, NULL, 0);
+  }
+
+  std::list<process::Future<Nothing> > released;
+  for(int c = 0; c < n; c++) {
+    released.push_back(after.release(containerId(c)));
+  }
+  process::collect(released).await();
+
+  const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+  std::cout << "containers " << n << ", io workers " << ioWorkers
+            << ", pool " << poolSize << std::endl;
+  std::cout << "recovered in " << ms << " ms" << std::endl;
+  std::cout << (ok ? "ok" : "FAILED") << std::endl;
+
+  return ok ? 0 : 1;
+}
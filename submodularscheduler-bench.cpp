@@ -0,0 +1,219 @@
+#include <chrono>
+#include <iostream>
+#include <cmath>
+
+#include "SubmodularScheduler.hpp"
+#include "submodularscheduler-bench.hpp"
+
+template< int N >
+static bool bench(const float budget, const int reps) {
+  CoreMask greedy, lazy;
+
+  SubmodularScheduler< BenchPolicy<N> > gscheduler(GREEDY);
+  SubmodularScheduler< BenchPolicy<N> > lscheduler(LAZY_GREEDY);
+
+  const auto gstart = std::chrono::steady_clock::now();
+  for(int i = 0; i < reps; i++) {
+    gscheduler(greedy, budget);
+  }
+  const auto gend = std::chrono::steady_clock::now();
+
+  const auto lstart = std::chrono::steady_clock::now();
+  for(int i = 0; i < reps; i++) {
+    lscheduler(lazy, budget);
+  }
+  const auto lend = std::chrono::steady_clock::now();
+
+  const double gus =
+    std::chrono::duration<double, std::micro>(gend - gstart).count() / reps;
+  const double lus =
+    std::chrono::duration<double, std::micro>(lend - lstart).count() / reps;
+
+  std::cout << N << "\t"
+            << gscheduler.evaluations() << "\t" << gus << "\t"
+            << lscheduler.evaluations() << "\t" << lus << "\t"
+            << ((greedy == lazy) ? "same" : "DIFFERENT") << std::endl;
+
+  return greedy == lazy;
+}
+
+// one full gain sweep (every core as a candidate
+// against a half-covered G), valarray loop versus
+// the padded similarity matrix kernel
+//
+template< int N >
+static void kernel_bench(const int reps) {
+  BenchPolicy<N> policy;
+  const std::valarray<float> weights = policy.getWeightVector();
+
+  std::valarray<float> simva(N * N);
+  for(int i = 0; i < N; i++) {
+    for(int j = 0; j < N; j++) {
+      simva[i * N + j] = policy.getSimilarity(i, j);
+    }
+  }
+
+  SimilarityMatrix sim;
+  sim.build(N, policy);
+
+  CoreMask V;
+  for(int i = 0; i < N; i++) {
+    V.insert(i);
+  }
+
+  CoverageState state(sim, weights, V);
+  std::valarray<float> cover(0.0, N), cap(0.0, N);
+
+  for(int i = 0; i < N; i++) {
+    for(int j = 0; j < N; j++) {
+      cap[i] += weights[j] * simva[j * N + i];
+    }
+  }
+
+  for(int l = 0; l < N; l += 2) {
+    state.add(l);
+    for(int i = 0; i < N; i++) {
+      cover[i] += weights[l] * simva[l * N + i];
+    }
+  }
+
+  float vsum = 0.0, ksum = 0.0;
+
+  const auto vstart = std::chrono::steady_clock::now();
+  for(int rep = 0; rep < reps; rep++) {
+    for(int l = 0; l < N; l++) {
+      const std::valarray<float> row = simva[std::slice(l * N, N, 1)];
+      float delta = 0.0;
+      for(int i = 0; i < N; i++) {
+        delta += std::min(cover[i] + weights[l] * row[i], cap[i]) - std::min(cover[i], cap[i]);
+      }
+      vsum += delta;
+    }
+  }
+  const auto vend = std::chrono::steady_clock::now();
+
+  const auto kstart = std::chrono::steady_clock::now();
+  for(int rep = 0; rep < reps; rep++) {
+    for(int l = 0; l < N; l++) {
+      ksum += state.gain(l);
+    }
+  }
+  const auto kend = std::chrono::steady_clock::now();
+
+  std::cout << N << "\t"
+            << std::chrono::duration<double, std::micro>(vend - vstart).count() / reps << "\t"
+            << std::chrono::duration<double, std::micro>(kend - kstart).count() / reps << "\t"
+            << ((std::abs(vsum - ksum) <= 1e-3 * std::abs(vsum)) ? "same" : "DIFFERENT")
+            << std::endl;
+}
+
+// quality of a stochastic placement relative
+// to the (exact) lazy greedy placement
+//
+template< typename Policy >
+static void stochastic_bench(
+  const char* name,
+  const int n,
+  const float budget,
+  const float epsilon,
+  const int trials) {
+
+  CoreMask greedy, stochastic;
+
+  SubmodularScheduler< Policy > lscheduler(LAZY_GREEDY);
+
+  const auto lstart = std::chrono::steady_clock::now();
+  lscheduler(greedy, budget);
+  const auto lend = std::chrono::steady_clock::now();
+
+  double ratio = 0.0, worst = 1.0, us = 0.0;
+  unsigned long evals = 0;
+
+  for(int t = 0; t < trials; t++) {
+    SubmodularScheduler< Policy > sscheduler(
+      SubmodularSchedulerOptions(STOCHASTIC_GREEDY, epsilon, t + 1));
+
+    const auto sstart = std::chrono::steady_clock::now();
+    sscheduler(stochastic, budget);
+    const auto send = std::chrono::steady_clock::now();
+
+    const double q = sscheduler.value() / lscheduler.value();
+    ratio += q;
+    worst = std::min(worst, q);
+    evals += sscheduler.evaluations();
+    us += std::chrono::duration<double, std::micro>(send - sstart).count();
+  }
+
+  std::cout << name << "\t" << n << "\t" << budget << "\t" << epsilon << "\t"
+            << lscheduler.evaluations() << "\t"
+            << std::chrono::duration<double, std::micro>(lend - lstart).count() << "\t"
+            << (evals / trials) << "\t"
+            << (us / trials) << "\t"
+            << (ratio / trials) << "\t" << worst << std::endl;
+}
+
+// number of 8 core l3 domains a placement on an
+// idle machine spans, with and without getDomains()
+//
+template< int N >
+static void domain_bench(const float budget) {
+  CoreMask grouped, ungrouped;
+
+  SubmodularScheduler< IdleHierarchicalBenchPolicy<N> > gscheduler(LAZY_GREEDY);
+  SubmodularScheduler< UngroupedHierarchicalBenchPolicy<N> > uscheduler(LAZY_GREEDY);
+
+  const auto gstart = std::chrono::steady_clock::now();
+  gscheduler(grouped, budget);
+  const auto gend = std::chrono::steady_clock::now();
+
+  const auto ustart = std::chrono::steady_clock::now();
+  uscheduler(ungrouped, budget);
+  const auto uend = std::chrono::steady_clock::now();
+
+  CoreMask gl3, ul3;
+  foreach(int c, grouped) { gl3.insert(c / 8); }
+  foreach(int c, ungrouped) { ul3.insert(c / 8); }
+
+  std::cout << N << "\t" << budget << "\t"
+            << grouped.size() << "\t" << gl3.size() << "\t"
+            << std::chrono::duration<double, std::micro>(gend - gstart).count() << "\t"
+            << ungrouped.size() << "\t" << ul3.size() << "\t"
+            << std::chrono::duration<double, std::micro>(uend - ustart).count() << std::endl;
+}
+
+int main(int argc, char** argv) {
+  const float budget = (argc > 1) ? std::stof(argv[1]) : 4.0;
+
+  std::cout << "cores\tgreedy-evals\tgreedy-us\tlazy-evals\tlazy-us\tplacement" << std::endl;
+
+  bool same = bench<16>(budget, 10);
+  same = bench<64>(budget, 3) && same;
+  same = bench<256>(budget, 1) && same;
+  same = bench<1024>(budget, 1) && same;
+
+  std::cout << "\ncores\tvalarray-sweep-us\t" << coverage_kernel()
+            << "-sweep-us\tgains" << std::endl;
+
+  kernel_bench<64>(1000);
+  kernel_bench<256>(100);
+  kernel_bench<1024>(10);
+
+  std::cout << "\ntopology\tcores\tbudget\tepsilon\tlazy-evals\tlazy-us\tstochastic-evals\tstochastic-us\tmean-f-ratio\tworst-f-ratio" << std::endl;
+
+  stochastic_bench< BenchPolicy<512> >("linear", 512, 16, 0.1, 10);
+  stochastic_bench< HierarchicalBenchPolicy<512> >("hierarchical", 512, 16, 0.1, 10);
+  stochastic_bench< HierarchicalBenchPolicy<512> >("hierarchical", 512, 16, 0.5, 10);
+  stochastic_bench< BenchPolicy<2048> >("linear", 2048, 64, 0.1, 3);
+  stochastic_bench< HierarchicalBenchPolicy<2048> >("hierarchical", 2048, 64, 0.1, 3);
+  stochastic_bench< HierarchicalBenchPolicy<2048> >("hierarchical", 2048, 64, 0.5, 3);
+
+  std::cout << "\ncores\tbudget\tdomain-cores\tdomain-l3s\tdomain-us\tfree-cores\tfree-l3s\tfree-us" << std::endl;
+
+  domain_bench<128>(8);
+  domain_bench<128>(16);
+  domain_bench<512>(8);
+  domain_bench<512>(16);
+  domain_bench<512>(32);
+
+  return same ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+#include <vector>
+#include <valarray>
+#include <random>
+#include <cstdlib>
+
+#include "CoreMask.hpp"
+
+// synthetic N core machine, core loads are
+// drawn from a seeded engine so every run
+// of the benchmark sees the same machine
+//
+template< int N >
+struct BenchPolicy {
+
+  BenchPolicy() {
+    std::mt19937 gen(N);
+    std::uniform_int_distribution<int> tasks(1, 8);
+
+    cpu_cost.resize(N);
+    for(int i = 0; i < N; i++) {
+      cpu_cost[i] = static_cast<float>(tasks(gen));
+    }
+  }
+
+  int getNumItems() {
+    return N;
+  }
+
+  std::vector<int> getItems() {
+    std::vector<int> cpus;
+    for(int i = 0; i < getNumItems(); i++) {
+      cpus.push_back(i);
+    }
+
+    return cpus;
+  }
+
+  float getSimilarity(const int r, const int c) {
+    return 1.0 / (1.0 + std::abs(r - c));
+  }
+
+  std::vector< std::vector<CoreMask> > getDomains() {
+    return std::vector< std::vector<CoreMask> >();
+  }
+
+  std::valarray<float> getCostVector() {
+    return cpu_cost;
+  }
+
+  std::valarray<float> getWeightVector() {
+    return PU / cpu_cost;
+  }
+
+  const float PU = 2.0;
+
+  std::valarray<float> cpu_cost;
+
+};
+
+// synthetic N core machine laid out as sockets of
+// 32 cores split into L3 domains of 8 cores
+//
+template< int N >
+struct HierarchicalBenchPolicy : public BenchPolicy<N> {
+
+  float getSimilarity(const int r, const int c) {
+    const float d = (r == c) ? 0.0 :
+                    (r / 8 == c / 8) ? 1.0 :
+                    (r / 32 == c / 32) ? 2.0 : 4.0;
+
+    return 1.0 / (1.0 + d);
+  }
+
+  std::vector< std::vector<CoreMask> > getDomains() {
+    std::vector< std::vector<CoreMask> > levels(2);
+    levels[0].resize(N / 8);
+    levels[1].resize(N / 32);
+
+    for(int i = 0; i < N; i++) {
+      levels[0][i / 8].insert(i);
+      levels[1][i / 32].insert(i);
+    }
+
+    return levels;
+  }
+
+};
+
+// an idle hierarchical machine without its domains,
+// the scheduler is free to span l3s and sockets
+//
+template< int N >
+struct UngroupedHierarchicalBenchPolicy : public HierarchicalBenchPolicy<N> {
+
+  UngroupedHierarchicalBenchPolicy() {
+    this->cpu_cost = 1.0;
+  }
+
+  std::vector< std::vector<CoreMask> > getDomains() {
+    return std::vector< std::vector<CoreMask> >();
+  }
+
+};
+
+// the same idle machine with its domains
+//
+template< int N >
+struct IdleHierarchicalBenchPolicy : public HierarchicalBenchPolicy<N> {
+
+  IdleHierarchicalBenchPolicy() {
+    this->cpu_cost = 1.0;
+  }
+
+};
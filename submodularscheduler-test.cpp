@@ -1,21 +1,87 @@
-#include <set>
 #include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "SubmodularScheduler.hpp"
 #include "submodularscheduler-test.hpp"
 
 int main(int argc, char** argv) {
-  std::set<int> cpusets;
+  bool ok = true;
 
-  SubmodularScheduler<TestPolicy> scheduler;
-  scheduler(cpusets, 4.0);
+  // a budget of b cores places b cores,
+  // with uniform and with uneven cost
+  //
+  for(int budget = 1; budget <= 4; budget++) {
+    CoreMask cpusets;
 
-  std::for_each(std::begin(cpusets), std::end(cpusets),
-    [](int cpu) {
-    std::cout << "cpu\t" << cpu << std::endl;
+    SubmodularScheduler<TestPolicy> scheduler;
+    scheduler(cpusets, budget);
+
+    std::cout << "budget\t" << budget << std::endl;
+    std::for_each(std::begin(cpusets), std::end(cpusets),
+      [](int cpu) {
+      std::cout << "cpu\t" << cpu << std::endl;
+    });
+
+    if(cpusets.size() != budget) {
+      std::cout << "placed " << cpusets.size() << " cpus" << std::endl;
+      ok = false;
+    }
+  }
+
+  for(int budget = 1; budget <= 3; budget++) {
+    CoreMask cpusets;
+
+    SubmodularScheduler<LoadedTestPolicy> scheduler(LAZY_GREEDY);
+    scheduler(cpusets, budget);
+
+    std::cout << "loaded budget\t" << budget << std::endl;
+    std::for_each(std::begin(cpusets), std::end(cpusets),
+      [](int cpu) {
+      std::cout << "cpu\t" << cpu << std::endl;
+    });
+
+    if(cpusets.size() != budget || cpusets.count(3)) {
+      std::cout << "placed " << cpusets.size() << " cpus" << std::endl;
+      ok = false;
+    }
+
+    // the idle core comes before the busy ones
+    if(!cpusets.count(0)) {
+      std::cout << "idle cpu 0 not placed" << std::endl;
+      ok = false;
+    }
+  }
+
+  // one core containers placed one after another
+  // on eight cores spread one per core
+  //
+  std::vector<int> holders(8, 0);
+  for(int n = 0; n < 8; n++) {
+    CoreMask cpusets;
+
+    SubmodularScheduler<OccupancyTestPolicy> scheduler(
+      SubmodularSchedulerOptions(LAZY_GREEDY), holders);
+    scheduler(cpusets, 1);
+
+    std::for_each(std::begin(cpusets), std::end(cpusets),
+      [&holders](int cpu) {
+      holders[cpu]++;
+    });
+  }
+
+  std::cout << "holders";
+  std::for_each(std::begin(holders), std::end(holders),
+    [](int h) {
+    std::cout << "\t" << h;
   });
+  std::cout << std::endl;
 
-  return 1;
-}
+  if(std::count(std::begin(holders), std::end(holders), 1) != 8) {
+    std::cout << "containers stacked on a core" << std::endl;
+    ok = false;
+  }
 
+  std::cout << (ok ? "ok" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -1,5 +1,10 @@
 #include <vector>
 #include <valarray>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "CoreMask.hpp"
 
 struct TestPolicy {
 
@@ -16,9 +21,13 @@ struct TestPolicy {
     return cpus;
   }
 
-  int getSimilarity(const int r, const int c) {
+  float getSimilarity(const int r, const int c) {
     std::valarray<float> toret = distance[std::slice(r, cpu_cost.size(), cpu_cost.size())];
-    return toret[c];
+    return 1.0 / (1.0 + toret[c]);
+  }
+
+  std::vector< std::vector<CoreMask> > getDomains() {
+    return std::vector< std::vector<CoreMask> >();
   }
 
   std::valarray<float> getCostVector() {
@@ -29,8 +38,9 @@ struct TestPolicy {
     cpu_weights.resize(cpu_cost.size());
     cpu_weights = 0.0;
 
+    // free capacity, as CoreOccupancy::load
     for(int i = 0; i < cpu_cost.size(); i++) {
-      cpu_weights[i] = cpu_cost[i]; //PU;
+      cpu_weights[i] = std::isfinite(cpu_cost[i]) ? PU / cpu_cost[i] : 0.0;
     }
 
     return cpu_weights;
@@ -49,3 +59,55 @@ struct TestPolicy {
 
 };
 
+
+// cores already holding containers cost
+// more, core 3 is outside the agent's cpuset
+struct LoadedTestPolicy : public TestPolicy {
+
+  LoadedTestPolicy() {
+    cpu_cost = { 1.0, 2.0, 3.0, std::numeric_limits<float>::infinity() };
+  }
+
+};
+
+// eight cores in a row, cost is one plus the
+// containers a core holds (CoreOccupancy::load)
+struct OccupancyTestPolicy {
+
+  OccupancyTestPolicy(const std::vector<int>& holders_)
+    : holders(holders_) {
+  }
+
+  std::vector<int> getItems() {
+    std::vector<int> cpus;
+    for(int i = 0; i < static_cast<int>(holders.size()); i++) {
+      cpus.push_back(i);
+    }
+
+    return cpus;
+  }
+
+  float getSimilarity(const int r, const int c) {
+    return 1.0 / (1.0 + std::abs(r - c));
+  }
+
+  std::vector< std::vector<CoreMask> > getDomains() {
+    return std::vector< std::vector<CoreMask> >();
+  }
+
+  std::valarray<float> getCostVector() {
+    std::valarray<float> cost(holders.size());
+    for(size_t i = 0; i < holders.size(); i++) {
+      cost[i] = 1.0 + holders[i];
+    }
+
+    return cost;
+  }
+
+  std::valarray<float> getWeightVector() {
+    return 2.0f / getCostVector();
+  }
+
+  std::vector<int> holders;
+
+};